@@ -0,0 +1,372 @@
+/*******************************************************
+ * batch_input.h
+ * 批量输入: 目录 / glob / stdin 文件清单展开成图片列表，
+ * 解码线程池按顺序提前解码，NPU 那一段只从这里取现成的帧。
+ *
+ * 文件走只读 mmap 直接交给 libjpeg-turbo，不 fread 拷贝；
+ * 领到第 i 张时对第 i + depth 张发 POSIX_FADV_WILLNEED，
+ * 磁盘 / SD 卡读取在后台和当前解码重叠。
+ * 最多 depth 张解好的帧在途（各占一块池子里的 dma-buf），
+ * 消费慢时解码线程自己停下，内存不随清单长度增长。
+ *******************************************************/
+#ifndef BATCH_INPUT_H
+#define BATCH_INPUT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "jpeg_decoder.h"
+#include "preprocess.h"
+#include "dma_pool.h"
+#include "frame_ingest.h"
+#include "trace.h"
+
+#define BATCH_MAX_WORKERS 8
+
+/* =================== 图片列表 =================== */
+static inline bool is_jpeg_name(const char *name)
+{
+    const char *dot = strrchr(name, '.');
+    return dot && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0);
+}
+
+/*
+ * 一个命令行参数展开成图片路径，追加到 out:
+ *   "-"          stdin 每行一个路径（空行跳过）
+ *   目录         目录下的 .jpg / .jpeg，按文件名排序，不递归
+ *   含 * ? [     glob(3) 展开（已排序）
+ *   其他         原样当作一个文件
+ * 成功返回 0；目录打不开或 glob 没有匹配返回 -1。
+ */
+static inline int collect_images(const char *arg, std::vector<std::string> &out)
+{
+    if (strcmp(arg, "-") == 0)
+    {
+        char *line = NULL;
+        size_t cap = 0;
+        ssize_t len;
+        while ((len = getline(&line, &cap, stdin)) > 0)
+        {
+            while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+                line[--len] = 0;
+            if (len > 0)
+                out.push_back(line);
+        }
+        free(line);
+        return 0;
+    }
+
+    struct stat st;
+    if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        DIR *dir = opendir(arg);
+        if (!dir)
+        {
+            printf("open dir %s failed: %s\n", arg, strerror(errno));
+            return -1;
+        }
+        std::vector<std::string> names;
+        while (struct dirent *e = readdir(dir))
+        {
+            if (e->d_name[0] != '.' && is_jpeg_name(e->d_name))
+                names.push_back(e->d_name);
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+
+        std::string prefix(arg);
+        if (prefix.empty() || prefix[prefix.size() - 1] != '/')
+            prefix += '/';
+        for (size_t i = 0; i < names.size(); i++)
+            out.push_back(prefix + names[i]);
+        return 0;
+    }
+
+    if (strpbrk(arg, "*?["))
+    {
+        glob_t g;
+        int ret = glob(arg, 0, NULL, &g);
+        if (ret != 0)
+        {
+            printf("no match for %s\n", arg);
+            if (ret != GLOB_NOMATCH)
+                globfree(&g);
+            return -1;
+        }
+        for (size_t i = 0; i < g.gl_pathc; i++)
+            out.push_back(g.gl_pathv[i]);
+        globfree(&g);
+        return 0;
+    }
+
+    out.push_back(arg);
+    return 0;
+}
+
+/* =================== 解码目标 =================== */
+// 解码尺寸怎么选: 按 letterbox 的缩放尺寸，或直接拉伸到 fit_w x fit_h
+struct DecodeTarget
+{
+    int fit_w, fit_h;
+    bool letterbox;
+    int ingest; // JpegIngest
+};
+
+// DCT 缩放到不小于目标尺寸，再按 ingest 排布
+static inline JpegLayout decode_target_layout(const DecodeTarget &t, const JpegInfo &info)
+{
+    int min_w = t.fit_w, min_h = t.fit_h;
+    if (t.letterbox)
+    {
+        LetterboxInfo lb = letterbox_info(info.width, info.height, t.fit_w, t.fit_h);
+        min_w = lb.resize_w;
+        min_h = lb.resize_h;
+    }
+    int dec_w, dec_h;
+    jpeg_pick_scale(info.width, info.height, min_w, min_h, &dec_w, &dec_h);
+    return jpeg_layout(info, dec_w, dec_h, t.ingest);
+}
+
+/* =================== 提前解码 =================== */
+// JPEG 这一路的帧生产: 整个 JPEG 按 target 解码进池子里的 dma-buf，
+// 填 img 的尺寸 / image / buf；成功返回 0
+static inline int decode_jpeg_image(JpegDecoder &jpeg, const unsigned char *jpg, size_t len,
+                                    const DecodeTarget &target, IngestFrame &img)
+{
+    TRACE_SPAN("jpeg_decode");
+    JpegInfo info;
+    if (jpeg.read_header(jpg, len, &info) != 0)
+        return -1;
+    JpegLayout l = decode_target_layout(target, info);
+    img.buf = dma_pool_cached().acquire(l.size);
+    if (!img.buf)
+        return -1;
+    int ret;
+    {
+        DmaCpuAccess cpu(img.buf, DMA_BUF_SYNC_WRITE);
+        ret = jpeg.decode(jpg, len, l, (uint8_t *)img.buf.virt());
+    }
+    if (ret != 0)
+    {
+        img.buf.reset();
+        return ret;
+    }
+    img.src_width = info.width;
+    img.src_height = info.height;
+    img.image = make_image_buffer(img.buf.fd(), img.buf.virt(), l.width, l.height, l.format,
+                                  l.wstride, l.hstride);
+    return 0;
+}
+
+struct DecodeAheadStats
+{
+    long decoded, failed;
+    double wait_ms; // 消费方等解码的累计时间，长说明瓶颈在读盘 / 解码而不是 NPU
+};
+
+class DecodeAhead : public FrameSource
+{
+public:
+    /*
+     * paths 在对象生命周期内不能变。workers 个解码线程，depth 张在途；
+     * 单核的 RV1106 上一个线程主要是把读盘藏到 NPU 后面，多核板子再加线程。
+     */
+    DecodeAhead(const std::vector<std::string> &paths, const DecodeTarget &target,
+                int workers, int depth)
+        : paths(paths), target(target), ring(depth < 1 ? 1 : depth),
+          next_job(0), consumed(0), stopping(false), decoded(0), failed(0), wait_ns(0)
+    {
+        if (workers < 1)
+            workers = 1;
+        if (workers > BATCH_MAX_WORKERS)
+            workers = BATCH_MAX_WORKERS;
+        for (size_t i = 0; i < ring.size(); i++)
+            ring[i].ready = false;
+
+        // 开头的 depth 张先把读盘提示发出去
+        for (size_t i = 0; i < ring.size() && i < paths.size(); i++)
+            prefetch(paths[i].c_str());
+        for (int i = 0; i < workers; i++)
+            threads.push_back(std::thread(&DecodeAhead::worker_loop, this));
+    }
+
+    ~DecodeAhead()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+
+    DecodeAhead(const DecodeAhead &) = delete;
+    DecodeAhead &operator=(const DecodeAhead &) = delete;
+
+    // 按清单顺序取下一张；清单取完返回 false
+    bool next(IngestFrame &out) override
+    {
+        if (consumed >= (long)paths.size())
+            return false;
+        Entry &e = ring[consumed % ring.size()];
+        {
+            TRACE_SPAN("wait_decode");
+            auto t0 = std::chrono::steady_clock::now();
+            std::unique_lock<std::mutex> lock(mu);
+            cv.wait(lock, [&] { return e.ready; });
+            out = std::move(e.img);
+            e.ready = false;
+            consumed++;
+            wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - t0)
+                           .count();
+        }
+        // 空出的格子让解码线程接着往前走
+        cv.notify_all();
+        return true;
+    }
+
+    long size() const { return (long)paths.size(); }
+    int num_workers() const { return (int)threads.size(); }
+
+    DecodeAheadStats stats()
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        DecodeAheadStats st;
+        st.decoded = decoded;
+        st.failed = failed;
+        st.wait_ms = wait_ns / 1e6;
+        return st;
+    }
+
+    void print_stats()
+    {
+        DecodeAheadStats st = stats();
+        printf("decode-ahead: %d workers, depth %zu, %ld decoded, %ld failed, "
+               "consumer waited %.3f ms\n",
+               num_workers(), ring.size(), st.decoded, st.failed, st.wait_ms);
+    }
+
+private:
+    struct Entry
+    {
+        bool ready;
+        IngestFrame img;
+    };
+
+    // 只给内核一个预读提示，不等 I/O
+    static void prefetch(const char *path)
+    {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+
+    void worker_loop()
+    {
+        TRACE_THREAD_NAME("decode");
+        JpegDecoder jpeg;
+        for (;;)
+        {
+            long job;
+            {
+                // 领号受 depth 限制: 最多比消费方领先 ring.size() 张
+                std::unique_lock<std::mutex> lock(mu);
+                cv.wait(lock, [&] {
+                    return stopping || next_job >= (long)paths.size() ||
+                           next_job < consumed + (long)ring.size();
+                });
+                if (stopping || next_job >= (long)paths.size())
+                    return;
+                job = next_job++;
+            }
+            if (job + (long)ring.size() < (long)paths.size())
+                prefetch(paths[job + ring.size()].c_str());
+
+            IngestFrame img;
+            img.index = job;
+            img.path = paths[job].c_str();
+            img.source = 0;
+            img.t_capture_ns = 0;
+            img.ok = decode_file(jpeg, img) == 0;
+
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                if (img.ok)
+                    decoded++;
+                else
+                    failed++;
+                Entry &e = ring[job % ring.size()];
+                e.img = std::move(img);
+                e.ready = true;
+            }
+            cv.notify_all();
+        }
+    }
+
+    // 只读 mmap 整个文件直接解码进池子里的 dma-buf；成功返回 0
+    int decode_file(JpegDecoder &jpeg, IngestFrame &img)
+    {
+        int fd = ::open(img.path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            printf("open %s failed: %s\n", img.path, strerror(errno));
+            return -1;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            printf("bad image file %s\n", img.path);
+            close(fd);
+            return -1;
+        }
+        const size_t len = (size_t)st.st_size;
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED)
+        {
+            printf("mmap %s failed: %s\n", img.path, strerror(errno));
+            return -1;
+        }
+        madvise(map, len, MADV_WILLNEED);
+
+        int ret = decode_jpeg_image(jpeg, (const unsigned char *)map, len, target, img);
+        munmap(map, len);
+        if (ret != 0)
+            printf("%s: decode failed\n", img.path);
+        return ret;
+    }
+
+    const std::vector<std::string> &paths;
+    const DecodeTarget target;
+    std::vector<Entry> ring;
+
+    std::mutex mu;
+    std::condition_variable cv;
+    std::vector<std::thread> threads;
+    long next_job, consumed;
+    bool stopping;
+    long decoded, failed;
+    uint64_t wait_ns;
+};
+
+#endif
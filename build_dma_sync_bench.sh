@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# 获取当前脚本所在目录
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PROJECT_ROOT="$SCRIPT_DIR"
+
+echo "当前工作目录: $PROJECT_ROOT"
+
+# 交叉编译工具链相对路径
+TOOLCHAIN_DIR="$PROJECT_ROOT/toolchains/arm-rockchip830-linux-uclibcgnueabihf"
+CXX="$TOOLCHAIN_DIR/bin/arm-rockchip830-linux-uclibcgnueabihf-g++"
+
+# 检查工具链是否存在
+if [ ! -f "$CXX" ]; then
+    echo "错误: 找不到交叉编译工具链: $CXX"
+    echo "请确保toolchains目录下包含正确的工具链"
+    exit 1
+fi
+
+
+rm -rf dma_sync_bench_arm
+
+$CXX \
+    dma_sync_bench.cpp \
+    -o dma_sync_bench_arm \
+    -O2 -Wall -s
+
+echo "完成！输出文件: dma_sync_bench_arm"
+file dma_sync_bench_arm
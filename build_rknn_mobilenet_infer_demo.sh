@@ -32,6 +32,7 @@ $CXX \
     -lturbojpeg \
     -lrga \
     -lrknnmrt \
+    -lpthread \
     -O2 -Wall -s
 
 echo "完成！输出文件: rknn_mobilenet_infer_demo_arm"
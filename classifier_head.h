@@ -0,0 +1,142 @@
+/*******************************************************
+ * classifier_head.h
+ * 分类模型输出头: 直接在 int8 / uint8 量化输出上做 top-k，
+ * 不反量化整张量、不逐元素 expf、逐帧不分配。
+ *
+ * softmax 单调，top-k 只看量化值；概率 exp(l_i - l_max) / sum 里
+ * l_i - l_max = (q_i - q_max) * scale，只跟量化差有关，按差值查表；
+ * 分母用 256 格直方图加权求和，差值超过 CLS_HEAD_CUTOFF 的格子
+ * 贡献已小于 float 精度，直接不算。
+ *******************************************************/
+#ifndef CLASSIFIER_HEAD_H
+#define CLASSIFIER_HEAD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "rknn_api.h"
+#include "int8_kernels.h"
+
+#define CLS_HEAD_MAX_K 16
+#define CLS_HEAD_CUTOFF 17.0f // exp(-17) ≈ 4e-8
+
+struct ClassScore
+{
+    int cls;
+    float prob;
+};
+
+class ClassifierHead
+{
+public:
+    ClassifierHead() : n(0), k(0), is_u8(false), dcut(256) {}
+
+    /*
+     * attr: 输出张量属性（按普通 NCHW 输出绑定，n_elems 个连续元素）
+     * 只支持 INT8 / UINT8 非对称量化；k <= CLS_HEAD_MAX_K。成功返回 0。
+     */
+    int init(const rknn_tensor_attr &attr, int top_k)
+    {
+        if (attr.type != RKNN_TENSOR_INT8 && attr.type != RKNN_TENSOR_UINT8)
+        {
+            printf("classifier head: unsupported output type %d\n", attr.type);
+            return -1;
+        }
+        if (attr.scale <= 0 || attr.n_elems == 0 || top_k < 1 || top_k > CLS_HEAD_MAX_K)
+        {
+            printf("classifier head: bad output attr or k=%d\n", top_k);
+            return -1;
+        }
+        n = attr.n_elems;
+        k = top_k < n ? top_k : n;
+        is_u8 = attr.type == RKNN_TENSOR_UINT8;
+
+        // exp_d[d] = exp(-d * scale)，d 为与最大值的量化差
+        for (int d = 0; d < 256; d++)
+            exp_d[d] = expf(-d * attr.scale);
+        dcut = (int)ceilf(CLS_HEAD_CUTOFF / attr.scale);
+        if (dcut > 256)
+            dcut = 256;
+
+        cand.resize(n);
+        return 0;
+    }
+
+    // logits: 输出 mem 的 virt_addr；top 至少 k 个，按概率降序（同分取小类别号）
+    int run(const void *logits, ClassScore *top)
+    {
+        // 1. 量化值直方图，bin = 量化值映射到 0..255，保持大小顺序
+        memset(hist, 0, sizeof(hist));
+        if (is_u8)
+        {
+            const uint8_t *v = (const uint8_t *)logits;
+            for (int i = 0; i < n; i++)
+                hist[v[i]]++;
+        }
+        else
+        {
+            const int8_t *v = (const int8_t *)logits;
+            for (int i = 0; i < n; i++)
+                hist[v[i] + 128]++;
+        }
+
+        // 2. 最大值、第 k 大所在的 bin、softmax 分母（截断）
+        int bmax = 255;
+        while (!hist[bmax])
+            bmax--;
+        int bth = bmax;
+        for (int seen = hist[bmax]; seen < k; seen += hist[bth])
+            bth--;
+        float sum = 0.f;
+        for (int d = 0; d < dcut && d <= bmax; d++)
+            sum += hist[bmax - d] * exp_d[d];
+
+        // 3. SIMD 压出 >= 门限的下标（升序），插进定长 top 表
+        int ncand = is_u8 ? compact_ge_u8((const uint8_t *)logits, n, (uint8_t)bth, cand.data())
+                          : compact_ge_s8((const int8_t *)logits, n, (int8_t)(bth - 128),
+                                          cand.data());
+        int bins[CLS_HEAD_MAX_K];
+        int m = 0;
+        for (int c = 0; c < ncand; c++)
+        {
+            int i = cand[c];
+            int b = bin_at(logits, i);
+            if (m == k && b <= bins[m - 1])
+                continue;
+            int j = m < k ? m++ : m - 1;
+            // 下标升序进来，同分不越过前面的，保证同分取小类别号
+            for (; j > 0 && bins[j - 1] < b; j--)
+            {
+                bins[j] = bins[j - 1];
+                top[j] = top[j - 1];
+            }
+            bins[j] = b;
+            top[j].cls = i;
+        }
+
+        const float inv = 1.0f / sum;
+        for (int j = 0; j < m; j++)
+            top[j].prob = exp_d[bmax - bins[j]] * inv;
+        return m;
+    }
+
+    int top_k() const { return k; }
+
+private:
+    int bin_at(const void *logits, int i) const
+    {
+        return is_u8 ? ((const uint8_t *)logits)[i] : ((const int8_t *)logits)[i] + 128;
+    }
+
+    int n, k;
+    bool is_u8;
+    int dcut;
+    float exp_d[256];
+    uint32_t hist[256];
+    std::vector<int32_t> cand; // compact 的下标缓冲，init 时定长
+};
+
+#endif
@@ -0,0 +1,31 @@
+/*******************************************************
+ * coco_labels.h
+ * COCO 80 类名，YOLOv8 demo 和级联 demo 共用
+ *******************************************************/
+#ifndef COCO_LABELS_H
+#define COCO_LABELS_H
+
+#include <stdio.h>
+
+static const char *coco_labels[80] = {
+    "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat",
+    "traffic light", "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat",
+    "dog", "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe", "backpack", "umbrella",
+    "handbag", "tie", "suitcase", "frisbee", "skis", "snowboard", "sports ball", "kite",
+    "baseball bat", "baseball glove", "skateboard", "surfboard", "tennis racket", "bottle",
+    "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple", "sandwich", "orange",
+    "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair", "couch", "potted plant",
+    "bed", "dining table", "toilet", "tv", "laptop", "mouse", "remote", "keyboard", "cell phone",
+    "microwave", "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase", "scissors",
+    "teddy bear", "hair drier", "toothbrush"};
+
+// 80 类模型给 COCO 名字，其它模型给 "cls<N>"
+static inline const char *coco_label(int cls, int num_classes, char *buf, size_t size)
+{
+    if (num_classes == 80 && cls >= 0 && cls < 80)
+        return coco_labels[cls];
+    snprintf(buf, size, "cls%d", cls);
+    return buf;
+}
+
+#endif
@@ -0,0 +1,391 @@
+/*******************************************************
+ * dma_pool.h
+ * dma-buf 缓冲池: heap fd 常开，按尺寸档回收已 mmap 的缓冲，
+ * 稳态帧不再 open / ioctl / mmap / munmap / close；
+ * CPU 访问用 DMA_BUF_IOCTL_SYNC 括起来，可以放心用带 cache 的 heap
+ *******************************************************/
+#ifndef DMA_POOL_H
+#define DMA_POOL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/dma-heap.h>
+#include <linux/dma-buf.h>
+#include <mutex>
+#include <vector>
+
+#define DMA_HEAP_CMA_PATH "/dev/rk_dma_heap/rk-dma-heap-cma"
+
+// 带 cache 的连续内存 heap，内核不同名字可能不同，编译时可用 -D 覆盖
+#ifndef DMA_HEAP_CACHED_PATH
+#define DMA_HEAP_CACHED_PATH "/dev/dma_heap/cma"
+#endif
+
+class DmaPool;
+
+/* =================== 句柄 =================== */
+/*
+ * 只能移动；析构或 reset() 时把缓冲还给池子，池子析构 / trim() 时才真正 munmap + close。
+ * CPU 读写 virt() 前后必须 sync_begin / sync_end（或用 DmaCpuAccess），
+ * 否则 cache 里的数据和 RGA / NPU 看到的不一致。
+ */
+class DmaBuffer
+{
+public:
+    DmaBuffer() : pool(NULL), fd_(-1), virt_(NULL), size_(0), cap_(0), dmabuf(false) {}
+    ~DmaBuffer() { reset(); }
+
+    DmaBuffer(DmaBuffer &&o) noexcept
+        : pool(o.pool), fd_(o.fd_), virt_(o.virt_), size_(o.size_), cap_(o.cap_),
+          dmabuf(o.dmabuf)
+    {
+        o.release_ownership();
+    }
+
+    DmaBuffer &operator=(DmaBuffer &&o) noexcept
+    {
+        if (this != &o)
+        {
+            reset();
+            pool = o.pool;
+            fd_ = o.fd_;
+            virt_ = o.virt_;
+            size_ = o.size_;
+            cap_ = o.cap_;
+            dmabuf = o.dmabuf;
+            o.release_ownership();
+        }
+        return *this;
+    }
+
+    DmaBuffer(const DmaBuffer &) = delete;
+    DmaBuffer &operator=(const DmaBuffer &) = delete;
+
+    int fd() const { return fd_; }
+    void *virt() const { return virt_; }
+    size_t size() const { return size_; }     // 申请的大小
+    size_t capacity() const { return cap_; }  // 实际映射的大小（尺寸档）
+    explicit operator bool() const { return virt_ != NULL; }
+
+    inline void reset();
+
+    /*
+     * flags 取 DMA_BUF_SYNC_READ / WRITE / RW。begin 让 CPU 看到设备写的数据，
+     * end 把 CPU 写的数据刷给设备；memfd（主机）上是空操作。
+     */
+    int sync_begin(uint64_t flags) const { return sync(DMA_BUF_SYNC_START | flags); }
+    int sync_end(uint64_t flags) const { return sync(DMA_BUF_SYNC_END | flags); }
+
+private:
+    friend class DmaPool;
+
+    void release_ownership()
+    {
+        pool = NULL;
+        fd_ = -1;
+        virt_ = NULL;
+        size_ = cap_ = 0;
+        dmabuf = false;
+    }
+
+    int sync(uint64_t flags) const
+    {
+        if (!dmabuf)
+            return 0;
+        struct dma_buf_sync s;
+        s.flags = flags;
+        if (ioctl(fd_, DMA_BUF_IOCTL_SYNC, &s) < 0)
+        {
+            perror("DMA_BUF_IOCTL_SYNC");
+            return -1;
+        }
+        return 0;
+    }
+
+    DmaPool *pool;
+    int fd_;
+    void *virt_;
+    size_t size_, cap_;
+    bool dmabuf;
+};
+
+// 一段 CPU 访问: 构造时 sync_begin，析构时 sync_end
+class DmaCpuAccess
+{
+public:
+    DmaCpuAccess(const DmaBuffer &buf, uint64_t flags) : buf(buf), flags(flags)
+    {
+        buf.sync_begin(flags);
+    }
+    ~DmaCpuAccess() { buf.sync_end(flags); }
+
+    DmaCpuAccess(const DmaCpuAccess &) = delete;
+    DmaCpuAccess &operator=(const DmaCpuAccess &) = delete;
+
+private:
+    const DmaBuffer &buf;
+    uint64_t flags;
+};
+
+/* =================== 池 =================== */
+struct DmaPoolStats
+{
+    size_t hits, misses;  // acquire 命中空闲缓冲 / 需要新分配
+    size_t live, cached;  // 借出中 / 空闲中的缓冲个数
+    size_t mapped_bytes;  // 当前映射的总字节数
+};
+
+class DmaPool
+{
+public:
+    // heap_path 打不开时试 fallback_path，都不行就退到 memfd
+    explicit DmaPool(const char *heap_path = DMA_HEAP_CMA_PATH, const char *fallback_path = NULL)
+        : heap_fd(-1), use_memfd(false), heap_name(heap_path)
+    {
+        memset(&stats_, 0, sizeof(stats_));
+        heap_fd = open(heap_path, O_RDWR | O_CLOEXEC);
+        if (heap_fd < 0 && fallback_path)
+        {
+            heap_fd = open(fallback_path, O_RDWR | O_CLOEXEC);
+            heap_name = fallback_path;
+        }
+        if (heap_fd < 0)
+        {
+            // 主机上没有 CMA heap，用 memfd 顶上，fd 语义一样（可 mmap、可传递）
+            use_memfd = true;
+            heap_name = "memfd";
+        }
+    }
+
+    ~DmaPool()
+    {
+        trim();
+        if (heap_fd >= 0)
+            close(heap_fd);
+    }
+
+    DmaPool(const DmaPool &) = delete;
+    DmaPool &operator=(const DmaPool &) = delete;
+
+    bool is_memfd() const { return use_memfd; }
+    const char *heap() const { return heap_name; }
+
+    // 借一块 >= size 字节的缓冲；失败时返回空句柄
+    DmaBuffer acquire(size_t size)
+    {
+        DmaBuffer b;
+        if (size == 0)
+            return b;
+
+        const int cls = size_class(size);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<Slot> &list = free_list[cls];
+            if (!list.empty())
+            {
+                Slot s = list.back();
+                list.pop_back();
+                stats_.hits++;
+                stats_.cached--;
+                stats_.live++;
+                return make_handle(s, size);
+            }
+            stats_.misses++;
+        }
+
+        Slot s;
+        s.cap = class_bytes(cls);
+        if (map_new(s.cap, &s.fd, &s.virt) != 0)
+            return b;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats_.live++;
+        stats_.mapped_bytes += s.cap;
+        return make_handle(s, size);
+    }
+
+    // 释放所有空闲缓冲（借出中的不受影响）
+    void trim()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int c = 0; c < NUM_CLASSES; c++)
+        {
+            for (size_t i = 0; i < free_list[c].size(); i++)
+            {
+                const Slot &s = free_list[c][i];
+                unmap(s);
+                stats_.mapped_bytes -= s.cap;
+            }
+            stats_.cached -= free_list[c].size();
+            free_list[c].clear();
+        }
+    }
+
+    DmaPoolStats stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats_;
+    }
+
+    void print_stats()
+    {
+        DmaPoolStats s = stats();
+        printf("dma pool (%s): hits=%zu misses=%zu live=%zu cached=%zu mapped=%zu KB\n",
+               heap_name, s.hits, s.misses, s.live, s.cached,
+               s.mapped_bytes / 1024);
+    }
+
+    /*
+     * 尺寸档: 一页以内一档，之后每个 2 的幂区间再切 4 档，
+     * 浪费不超过 25%，又能让相近尺寸（比如不同宽高的解码缓冲）复用同一块
+     */
+    static int size_class(size_t size)
+    {
+        if (size <= PAGE)
+            return 0;
+        size_t pages = (size + PAGE - 1) / PAGE;
+        int log2 = 0;
+        while ((pages - 1) >> (log2 + 1))
+            log2++;
+        // pages 落在 (2^log2, 2^(log2+1)]，按 1/4 细分
+        size_t base = (size_t)1 << log2;
+        size_t step = base >= 4 ? base / 4 : 1;
+        int sub = (int)((pages - base - 1) / step);
+        int cls = 1 + log2 * 4 + sub;
+        return cls < NUM_CLASSES ? cls : NUM_CLASSES - 1;
+    }
+
+    static size_t class_bytes(int cls)
+    {
+        if (cls == 0)
+            return PAGE;
+        int log2 = (cls - 1) / 4;
+        int sub = (cls - 1) % 4;
+        size_t base = (size_t)1 << log2;
+        size_t step = base >= 4 ? base / 4 : 1;
+        return (base + step * (sub + 1)) * PAGE;
+    }
+
+private:
+    friend class DmaBuffer;
+
+    enum
+    {
+        PAGE = 4096,
+        NUM_CLASSES = 1 + 20 * 4, // 最大到 4 GB
+    };
+
+    struct Slot
+    {
+        int fd;
+        void *virt;
+        size_t cap;
+    };
+
+    DmaBuffer make_handle(const Slot &s, size_t size)
+    {
+        DmaBuffer b;
+        b.pool = this;
+        b.fd_ = s.fd;
+        b.virt_ = s.virt;
+        b.size_ = size;
+        b.cap_ = s.cap;
+        b.dmabuf = !use_memfd;
+        return b;
+    }
+
+    void give_back(int fd, void *virt, size_t cap)
+    {
+        Slot s;
+        s.fd = fd;
+        s.virt = virt;
+        s.cap = cap;
+        std::lock_guard<std::mutex> lock(mutex);
+        free_list[size_class(cap)].push_back(s);
+        stats_.live--;
+        stats_.cached++;
+    }
+
+    int map_new(size_t cap, int *fd, void **virt)
+    {
+        *fd = -1;
+        if (!use_memfd)
+        {
+            struct dma_heap_allocation_data data;
+            memset(&data, 0, sizeof(data));
+            data.len = cap;
+            data.fd_flags = O_RDWR | O_CLOEXEC;
+            if (ioctl(heap_fd, DMA_HEAP_IOCTL_ALLOC, &data) < 0)
+            {
+                perror("DMA_HEAP_IOCTL_ALLOC");
+                return -1;
+            }
+            *fd = data.fd;
+        }
+        else
+        {
+#ifdef SYS_memfd_create
+            *fd = (int)syscall(SYS_memfd_create, "dma_pool", 1u /* MFD_CLOEXEC */);
+#endif
+            if (*fd < 0 || ftruncate(*fd, cap) != 0)
+            {
+                perror("memfd_create");
+                if (*fd >= 0)
+                    close(*fd);
+                return -1;
+            }
+        }
+
+        *virt = mmap(NULL, cap, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+        if (*virt == MAP_FAILED)
+        {
+            perror("mmap");
+            close(*fd);
+            return -1;
+        }
+        return 0;
+    }
+
+    static void unmap(const Slot &s)
+    {
+        munmap(s.virt, s.cap);
+        close(s.fd);
+    }
+
+    int heap_fd;
+    bool use_memfd;
+    const char *heap_name;
+    std::mutex mutex;
+    std::vector<Slot> free_list[NUM_CLASSES];
+    DmaPoolStats stats_;
+};
+
+inline void DmaBuffer::reset()
+{
+    if (pool && virt_)
+        pool->give_back(fd_, virt_, cap_);
+    release_ownership();
+}
+
+// 进程内共享的池（非 static，多个编译单元也只有一个），第一次调用时打开 heap
+inline DmaPool &dma_pool()
+{
+    static DmaPool pool;
+    return pool;
+}
+
+// CPU 要大量读写的缓冲（解码输出、CPU letterbox 等）从这里借，
+// 访问区间必须用 DmaCpuAccess 括起来；没有 cached heap 时退回 CMA heap
+inline DmaPool &dma_pool_cached()
+{
+    static DmaPool pool(DMA_HEAP_CACHED_PATH, DMA_HEAP_CMA_PATH);
+    return pool;
+}
+
+#endif
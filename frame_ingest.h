@@ -0,0 +1,101 @@
+/*******************************************************
+ * frame_ingest.h
+ * 统一的帧入口: 不管帧从哪来（JPEG 解码、原始帧拷贝、ISP / V4L2 导出的
+ * dma-buf），都整理成一个 IngestFrame 交给 letterbox / 缩放 / CSC，
+ * 由 RGA 一步写进模型输入张量。
+ *
+ * 外部 dma-buf 只借用: import_dma_frame 只校验描述、不映射、CPU 不碰像素；
+ * RGA 同步完成（preprocess / detect 返回）后调用方即可把缓冲还给 ISP。
+ *******************************************************/
+#ifndef FRAME_INGEST_H
+#define FRAME_INGEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "image_ops.h"
+#include "dma_pool.h"
+
+/* =================== 帧 =================== */
+// ok 为 false 时 image 无效，失败原因已经打印过
+struct IngestFrame
+{
+    long index;
+    const char *path;          // 来源名（文件路径 / 流名），只用来打印
+    int source;                // 第几路输入（--stream 的下标），文件清单 / 单个摄像头为 0
+    bool ok;
+    int src_width, src_height; // 原始尺寸，检测框按 src / image 的比例换回原图坐标
+    ImageBuffer image;         // 交给预处理的那一幅
+    DmaBuffer buf;             // image 的存储；外部 dma-buf 时为空
+    uint64_t t_capture_ns;     // 流输入时帧到齐的时刻（Tracer::now_ns），文件输入为 0
+
+    float scale_x() const { return (float)src_width / image.width; }
+    float scale_y() const { return (float)src_height / image.height; }
+};
+
+// 按顺序交出帧；文件清单和实时流各有一个实现，只能一个线程调用 next
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    // 没有更多帧时返回 false
+    virtual bool next(IngestFrame &out) = 0;
+};
+
+/* =================== 外部 dma-buf =================== */
+// ISP / V4L2 导出的一帧，缓冲归调用方所有
+struct DmaFrameDesc
+{
+    int fd;
+    int format;        // PixelFormat
+    int width, height;
+    int stride;        // 第一平面每行字节数，0 表示紧凑
+    int vstride;       // 第一平面的行数（色度平面从 stride * vstride 开始），0 表示等于高
+    int yuv_range;     // YuvRange，ISP 输出一般是 YUV_RANGE_LIMITED
+};
+
+/*
+ * 校验描述并包成只有 fd 的 ImageBuffer，CPU 不映射、不读写。
+ * 能查到 dma-buf 大小时检查它装得下整幅图。成功返回 0。
+ */
+static inline int import_dma_frame(const DmaFrameDesc &d, ImageBuffer *out)
+{
+    if (d.fd < 0 || d.width <= 0 || d.height <= 0)
+    {
+        printf("import dma frame: bad fd %d or size %dx%d\n", d.fd, d.width, d.height);
+        return -1;
+    }
+    const int bpp = pixel_bpp(d.format);
+    const int stride = d.stride > 0 ? d.stride : d.width * bpp;
+    const int wstride = stride / bpp;
+    const int hstride = d.vstride > 0 ? d.vstride : d.height;
+    const bool subsampled = d.format == PIXEL_YUV420P || d.format == PIXEL_YUV422P ||
+                            d.format == PIXEL_NV12 || d.format == PIXEL_YUYV;
+    const bool half_height = d.format == PIXEL_YUV420P || d.format == PIXEL_NV12;
+    if (d.format < PIXEL_RGBA8888 || d.format > PIXEL_GRAY8 || stride % bpp != 0 ||
+        wstride < d.width || hstride < d.height ||
+        (subsampled && ((d.width | wstride) & 1)) || (half_height && ((d.height | hstride) & 1)))
+    {
+        printf("import dma frame: bad layout format=%d %dx%d stride=%d vstride=%d\n",
+               d.format, d.width, d.height, d.stride, d.vstride);
+        return -1;
+    }
+
+    // dma-buf 支持 lseek(SEEK_END) 取大小；查不到（老内核）就只能信调用方
+    const size_t need = pixel_buffer_size(d.format, wstride, hstride);
+    off_t size = lseek(d.fd, 0, SEEK_END);
+    if (size >= 0 && (size_t)size < need)
+    {
+        printf("import dma frame: fd %d holds %lld bytes, layout needs %zu\n", d.fd,
+               (long long)size, need);
+        return -1;
+    }
+
+    *out = make_image_buffer(d.fd, NULL, d.width, d.height, d.format, wstride, hstride);
+    out->yuv_range = d.yuv_range;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,287 @@
+/*******************************************************
+ * host_check.cpp
+ * 主机自检，不需要板子和录制目录，不带参数直接跑；有一项不过退出码非 0:
+ *   默认后端: 不传 backend 的 Infer 在没有默认后端时抛异常，
+ *             装上默认后端后不传 backend 也能正常建起来（真机 demo 的构造方式）
+ *   后处理稳态零分配: 合成 NPU 后端喂 synth_yolo.h 的输出，
+ *   YoloDetector::run + postprocess 第一轮之后不应再有堆分配
+ *   运动门控: 按 RGA 缩放上限拒绝超限缩放的 ImageOps 下，
+ *             静止的 1080p 源第二帧起应被跳过
+ *******************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "npu_backend.h"
+#include "infer.h"
+#include "yolov8_detector.h"
+#include "synth_yolo.h"
+#include "motion_gate.h"
+
+// 与 rknn_yolov8s_infer_demo.cpp 保持一致
+#define CONF_THRESH 0.25f
+#define NMS_THRESH 0.45f
+#define MAX_DET 300
+
+/* =================== 分配计数 =================== */
+// 统计 operator new 次数；单线程，不用原子。
+// 不内联，免得 GCC 把 malloc / free 对上 new / delete 报 mismatched 警告
+static size_t g_alloc_count = 0;
+
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    g_alloc_count++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+/* =================== 合成 NPU 后端 =================== */
+// 输入 640x640x3 UINT8 NHWC；run 把下一幅合成场景拷进绑定的输出 mem
+class SynthNpuBackend : public NpuBackend
+{
+public:
+    explicit SynthNpuBackend(const std::vector<SynthYolo> &scenes) : scenes(scenes), runs(0)
+    {
+        memset(&in_attr, 0, sizeof(in_attr));
+        in_attr.index = 0;
+        strcpy(in_attr.name, "images");
+        in_attr.n_dims = 4;
+        in_attr.dims[0] = 1;
+        in_attr.dims[1] = 640;
+        in_attr.dims[2] = 640;
+        in_attr.dims[3] = 3;
+        in_attr.fmt = RKNN_TENSOR_NHWC;
+        in_attr.type = RKNN_TENSOR_UINT8;
+        in_attr.w_stride = 640;
+        in_attr.size_with_stride = in_attr.size = in_attr.n_elems = 640 * 640 * 3;
+    }
+
+    ~SynthNpuBackend()
+    {
+        for (size_t i = 0; i < mems.size(); i++)
+        {
+            free(mems[i]->virt_addr);
+            free(mems[i]);
+        }
+    }
+
+    int init(rknn_context *ctx, void *, uint32_t, uint32_t) override
+    {
+        *ctx = 1;
+        return RKNN_SUCC;
+    }
+
+    int destroy(rknn_context) override { return RKNN_SUCC; }
+
+    int query(rknn_context, rknn_query_cmd cmd, void *info, uint32_t size) override
+    {
+        const std::vector<rknn_tensor_attr> &outs = scenes[0].attrs;
+        if (cmd == RKNN_QUERY_IN_OUT_NUM && size >= sizeof(rknn_input_output_num))
+        {
+            rknn_input_output_num *n = (rknn_input_output_num *)info;
+            n->n_input = 1;
+            n->n_output = outs.size();
+            return RKNN_SUCC;
+        }
+        rknn_tensor_attr *a = (rknn_tensor_attr *)info;
+        if ((cmd == RKNN_QUERY_INPUT_ATTR || cmd == RKNN_QUERY_NATIVE_INPUT_ATTR) && a->index == 0)
+        {
+            *a = in_attr;
+            return RKNN_SUCC;
+        }
+        if ((cmd == RKNN_QUERY_OUTPUT_ATTR || cmd == RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR) &&
+            a->index < outs.size())
+        {
+            *a = outs[a->index];
+            return RKNN_SUCC;
+        }
+        return RKNN_ERR_PARAM_INVALID;
+    }
+
+    rknn_tensor_mem *create_mem(rknn_context, uint32_t size) override
+    {
+        rknn_tensor_mem *mem = (rknn_tensor_mem *)calloc(1, sizeof(rknn_tensor_mem));
+        mem->virt_addr = calloc(1, size);
+        mem->fd = -1;
+        mem->size = size;
+        mems.push_back(mem);
+        return mem;
+    }
+
+    int destroy_mem(rknn_context, rknn_tensor_mem *) override
+    {
+        // 析构时统一释放
+        return RKNN_SUCC;
+    }
+
+    int set_io_mem(rknn_context, rknn_tensor_mem *mem, rknn_tensor_attr *attr) override
+    {
+        if (strcmp(attr->name, in_attr.name) == 0)
+            return RKNN_SUCC;
+        if (bound.size() <= attr->index)
+            bound.resize(attr->index + 1);
+        bound[attr->index] = mem;
+        return RKNN_SUCC;
+    }
+
+    int run(rknn_context) override
+    {
+        const SynthYolo &s = scenes[runs++ % scenes.size()];
+        for (size_t i = 0; i < bound.size() && i < s.tensors.size(); i++)
+            memcpy(bound[i]->virt_addr, s.tensors[i].data(), s.tensors[i].size());
+        return RKNN_SUCC;
+    }
+
+private:
+    const std::vector<SynthYolo> &scenes;
+    long runs;
+    rknn_tensor_attr in_attr;
+    std::vector<rknn_tensor_mem *> mems;
+    std::vector<rknn_tensor_mem *> bound; // 按输出下标
+};
+
+/* =================== 检查项 =================== */
+static int check_default_backend(const std::vector<SynthYolo> &scenes)
+{
+    // NPU_BACKEND_NO_RKNN 下默认后端为 NULL
+    bool threw = false;
+    try
+    {
+        Infer no_backend(NULL, 0);
+    }
+    catch (const std::exception &)
+    {
+        threw = true;
+    }
+    if (!threw)
+    {
+        printf("default backend: Infer without a backend did not throw\n");
+        return -1;
+    }
+
+    SynthNpuBackend backend(scenes);
+    npu_set_default_backend(&backend);
+    int ret = 0;
+    try
+    {
+        Infer infer(NULL, 0);
+        if (infer.model_width() != 640 || infer.output_num() != (int)scenes[0].attrs.size() ||
+            infer.run() != 0)
+            ret = -1;
+    }
+    catch (const std::exception &e)
+    {
+        printf("default backend: %s\n", e.what());
+        ret = -1;
+    }
+    npu_set_default_backend(NULL);
+    printf("default backend: %s\n", ret == 0 ? "ok" : "failed");
+    return ret;
+}
+
+// 空场景到人群各一幅，第一轮热身，之后几轮 postprocess 里的分配次数应为 0
+static int check_postprocess_allocs(const std::vector<SynthYolo> &scenes)
+{
+    SynthNpuBackend backend(scenes);
+    std::unique_ptr<Infer> infer;
+    try
+    {
+        infer.reset(new Infer(NULL, 0, 0, &backend));
+    }
+    catch (const std::exception &e)
+    {
+        printf("postprocess allocs: %s\n", e.what());
+        return -1;
+    }
+    SoftImageOps soft_ops;
+    YoloDetector detector(*infer, soft_ops, CONF_THRESH, NMS_THRESH, MAX_DET);
+    if (detector.init() != 0)
+        return -1;
+
+    std::vector<Box> boxes;
+    boxes.reserve(MAX_DET);
+    size_t steady_allocs = 0, total_boxes = 0;
+    const int passes = 4;
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (size_t i = 0; i < scenes.size(); i++)
+        {
+            if (detector.run() != 0)
+                return -1;
+            const size_t before = g_alloc_count;
+            detector.postprocess(boxes);
+            if (pass > 0)
+                steady_allocs += g_alloc_count - before;
+            total_boxes += boxes.size();
+        }
+    }
+    printf("postprocess allocs: %zu scenes x %d passes, %zu boxes, %zu steady-state allocations\n",
+           scenes.size(), passes, total_boxes, steady_allocs);
+    // 没有框说明合成场景根本没走到解码 / NMS，这项检查就没意义
+    return steady_allocs == 0 && total_boxes > 0 ? 0 : -1;
+}
+
+// SoftImageOps 加上 RGA 的缩放限制，超过 RGA_MAX_SCALE 倍的缩放和真机一样失败
+class RgaLimitedOps : public SoftImageOps
+{
+public:
+    int resize(const ImageBuffer &src, const ImageRect &srect,
+               const ImageBuffer &dst, const ImageRect &drect) override
+    {
+        if (srect.w > drect.w * RGA_MAX_SCALE || srect.h > drect.h * RGA_MAX_SCALE ||
+            drect.w > srect.w * RGA_MAX_SCALE || drect.h > srect.h * RGA_MAX_SCALE)
+            return -1;
+        return SoftImageOps::resize(src, srect, dst, drect);
+    }
+};
+
+static int check_motion_gate_1080p()
+{
+    const int w = 1920, h = 1080;
+    std::vector<uint8_t> nv12(w * h * 3 / 2);
+    for (size_t i = 0; i < nv12.size(); i++)
+        nv12[i] = (uint8_t)(i * 7 + (i >> 11));
+    const ImageBuffer frame = make_image_buffer(-1, nv12.data(), w, h, PIXEL_NV12);
+
+    RgaLimitedOps ops;
+    MotionGate gate(ops, motion_gate_defaults());
+    if (gate.init() != 0)
+    {
+        printf("motion gate: init failed\n");
+        return -1;
+    }
+    const int frames = 10;
+    for (int i = 0; i < frames; i++)
+        gate.should_run(frame, 0);
+    const MotionGateStats &st = gate.stats();
+    printf("motion gate: %dx%d static source, %ld of %d frames skipped\n", w, h, st.skipped,
+           frames);
+    // 第一帧建参考，其余都该跳过
+    return st.skipped == frames - 1 ? 0 : -1;
+}
+
+int main()
+{
+    static const double densities[] = {0.0, 0.01, 0.05, 0.25};
+    std::vector<SynthYolo> scenes(sizeof(densities) / sizeof(densities[0]));
+    for (size_t i = 0; i < scenes.size(); i++)
+        scenes[i].build(densities[i], true, 100 + i);
+
+    int failed = 0;
+    failed += check_default_backend(scenes) != 0;
+    failed += check_postprocess_allocs(scenes) != 0;
+    failed += check_motion_gate_1080p() != 0;
+
+    printf("host_check: %s\n", failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}
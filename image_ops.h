@@ -0,0 +1,296 @@
+/*******************************************************
+ * image_ops.h
+ * 图像缓冲描述 + 缩放/填充接口，RGA 和纯 CPU 两种实现
+ *******************************************************/
+#ifndef IMAGE_OPS_H
+#define IMAGE_OPS_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* =================== 格式 =================== */
+enum PixelFormat
+{
+    PIXEL_RGBA8888 = 0,
+    PIXEL_RGB888,
+    PIXEL_YUV420P, // I420: Y 平面 + U/V 平面各 1/4
+    PIXEL_YUV422P, // Y 平面 + U/V 平面各 1/2（水平下采样）
+    PIXEL_NV12,    // Y 平面 + UV 交错平面（4:2:0），ISP 的常见输出
+    PIXEL_YUYV,    // 打包 4:2:2，Y0 U Y1 V，USB / BT.656 摄像头常见
+    PIXEL_GRAY8,   // 只有亮度，运动检测的缩略图用
+};
+
+static inline bool pixel_is_yuv(int format)
+{
+    return format == PIXEL_YUV420P || format == PIXEL_YUV422P || format == PIXEL_NV12 ||
+           format == PIXEL_YUYV;
+}
+
+// 打包格式的每像素字节数；平面 / 半平面格式返回 Y 平面的 1
+static inline int pixel_bpp(int format)
+{
+    switch (format)
+    {
+    case PIXEL_RGBA8888:
+        return 4;
+    case PIXEL_RGB888:
+        return 3;
+    case PIXEL_YUYV:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+// wstride x hstride 图像占用的总字节数
+static inline size_t pixel_buffer_size(int format, int wstride, int hstride)
+{
+    size_t luma = (size_t)wstride * hstride;
+    switch (format)
+    {
+    case PIXEL_YUV420P:
+    case PIXEL_NV12:
+        return luma * 3 / 2;
+    case PIXEL_YUV422P:
+        return luma * 2;
+    default:
+        return luma * pixel_bpp(format);
+    }
+}
+
+// YUV 的取值范围: JPEG (JFIF) 是全范围，ISP / 摄像头输出一般是 16~235 的有限范围
+enum YuvRange
+{
+    YUV_RANGE_FULL = 0,
+    YUV_RANGE_LIMITED,
+};
+
+/* =================== 缓冲 =================== */
+// fd 和 virt 至少有一个有效；wstride / hstride 以像素为单位，0 表示等于宽高
+struct ImageBuffer
+{
+    int fd;
+    void *virt;
+    int width, height;
+    int wstride, hstride;
+    int format;
+    int yuv_range; // 只对 YUV 格式有意义，BT.601
+};
+
+static inline ImageBuffer make_image_buffer(int fd, void *virt, int width, int height,
+                                            int format, int wstride = 0, int hstride = 0)
+{
+    ImageBuffer b;
+    b.fd = fd;
+    b.virt = virt;
+    b.width = width;
+    b.height = height;
+    b.wstride = wstride > 0 ? wstride : width;
+    b.hstride = hstride > 0 ? hstride : height;
+    b.format = format;
+    b.yuv_range = YUV_RANGE_FULL;
+    return b;
+}
+
+struct ImageRect
+{
+    int x, y, w, h;
+};
+
+static inline ImageRect make_rect(int x, int y, int w, int h)
+{
+    ImageRect r;
+    r.x = x;
+    r.y = y;
+    r.w = w;
+    r.h = h;
+    return r;
+}
+
+/* =================== 接口 =================== */
+// RGA 单次缩放倍数上限，放大、缩小都是；调用方按它拆分或过滤，CPU 实现不受限
+#define RGA_MAX_SCALE 16
+
+// 成功返回 0
+class ImageOps
+{
+public:
+    virtual ~ImageOps() {}
+
+    // src 的 srect 缩放（含格式转换）到 dst 的 drect，drect 之外不动
+    virtual int resize(const ImageBuffer &src, const ImageRect &srect,
+                       const ImageBuffer &dst, const ImageRect &drect) = 0;
+
+    // 用灰度值 value 填充 dst 的 rect
+    virtual int fill(const ImageBuffer &dst, const ImageRect &rect, uint8_t value) = 0;
+
+    // 同一张 src 的 n 个 srects[i] 各自缩放到 dsts[i] 整幅；默认逐个 resize
+    virtual int crop_batch(const ImageBuffer &src, const ImageRect *srects,
+                           const ImageBuffer *dsts, int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (resize(src, srects[i], dsts[i], make_rect(0, 0, dsts[i].width, dsts[i].height)) != 0)
+                return -1;
+        }
+        return 0;
+    }
+};
+
+/* =================== CPU 实现 =================== */
+// JPEG (JFIF) 用的全范围 BT.601，16 bit 定点
+static inline uint8_t clamp_u8(int v)
+{
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static inline void yuv_to_rgb(int y, int u, int v, uint8_t *rgb)
+{
+    u -= 128;
+    v -= 128;
+    rgb[0] = clamp_u8(y + ((91881 * v + 32768) >> 16));
+    rgb[1] = clamp_u8(y + ((-22554 * u - 46802 * v + 32768) >> 16));
+    rgb[2] = clamp_u8(y + ((116130 * u + 32768) >> 16));
+}
+
+// 有限范围 BT.601: Y 16~235、UV 16~240 先拉回全范围
+static inline void yuv_limited_to_rgb(int y, int u, int v, uint8_t *rgb)
+{
+    int yy = 76309 * (y - 16); // 255/219
+    u -= 128;
+    v -= 128;
+    rgb[0] = clamp_u8((yy + 104597 * v + 32768) >> 16);
+    rgb[1] = clamp_u8((yy - 25675 * u - 53279 * v + 32768) >> 16);
+    rgb[2] = clamp_u8((yy + 132201 * u + 32768) >> 16);
+}
+
+// 没有 RGA 的主机上代替 RgaImageOps，最近邻缩放，只用 virt
+class SoftImageOps : public ImageOps
+{
+public:
+    int resize(const ImageBuffer &src, const ImageRect &srect,
+               const ImageBuffer &dst, const ImageRect &drect) override
+    {
+        if (!src.virt || !dst.virt || drect.w <= 0 || drect.h <= 0 || pixel_is_yuv(dst.format))
+            return -1;
+        const int dbpp = pixel_bpp(dst.format);
+        uint8_t *d = (uint8_t *)dst.virt;
+
+        if (dst.format == PIXEL_GRAY8)
+        {
+            for (int y = 0; y < drect.h; y++)
+            {
+                int sy = srect.y + (int)((int64_t)y * srect.h / drect.h);
+                uint8_t *drow = d + (size_t)(drect.y + y) * dst.wstride + drect.x;
+                for (int x = 0; x < drect.w; x++)
+                    drow[x] = read_luma(src, srect.x + (int)((int64_t)x * srect.w / drect.w), sy);
+            }
+            return 0;
+        }
+
+        for (int y = 0; y < drect.h; y++)
+        {
+            int sy = srect.y + (int)((int64_t)y * srect.h / drect.h);
+            uint8_t *drow = d + (size_t)(drect.y + y) * dst.wstride * dbpp + drect.x * dbpp;
+            for (int x = 0; x < drect.w; x++)
+            {
+                int sx = srect.x + (int)((int64_t)x * srect.w / drect.w);
+                uint8_t *q = drow + x * dbpp;
+                uint8_t alpha = read_rgb(src, sx, sy, q);
+                if (dbpp == 4)
+                    q[3] = alpha;
+            }
+        }
+        return 0;
+    }
+
+    int fill(const ImageBuffer &dst, const ImageRect &rect, uint8_t value) override
+    {
+        if (!dst.virt || pixel_is_yuv(dst.format))
+            return -1;
+        const int bpp = pixel_bpp(dst.format);
+        for (int y = rect.y; y < rect.y + rect.h; y++)
+            memset((uint8_t *)dst.virt + ((size_t)y * dst.wstride + rect.x) * bpp,
+                   value, rect.w * bpp);
+        return 0;
+    }
+
+private:
+    // 读 (x, y) 的 RGB 写进 rgb[0..2]，返回 alpha
+    static uint8_t read_rgb(const ImageBuffer &src, int x, int y, uint8_t *rgb)
+    {
+        const uint8_t *s = (const uint8_t *)src.virt;
+        const size_t luma = (size_t)src.wstride * src.hstride;
+        switch (src.format)
+        {
+        case PIXEL_RGBA8888:
+        case PIXEL_RGB888:
+        {
+            const int bpp = pixel_bpp(src.format);
+            const uint8_t *p = s + ((size_t)y * src.wstride + x) * bpp;
+            rgb[0] = p[0];
+            rgb[1] = p[1];
+            rgb[2] = p[2];
+            return bpp == 4 ? p[3] : 0xff;
+        }
+        case PIXEL_YUV420P:
+        case PIXEL_YUV422P:
+        {
+            const int cw = src.wstride / 2;
+            const int cy = src.format == PIXEL_YUV420P ? y / 2 : y;
+            const size_t csize = src.format == PIXEL_YUV420P ? luma / 4 : luma / 2;
+            const size_t ci = (size_t)cy * cw + x / 2;
+            convert(src, s[(size_t)y * src.wstride + x], s[luma + ci], s[luma + csize + ci], rgb);
+            return 0xff;
+        }
+        case PIXEL_NV12:
+        {
+            // UV 平面每行 wstride 字节，U V 交错
+            const uint8_t *uv = s + luma + (size_t)(y / 2) * src.wstride + (x & ~1);
+            convert(src, s[(size_t)y * src.wstride + x], uv[0], uv[1], rgb);
+            return 0xff;
+        }
+        case PIXEL_YUYV:
+        {
+            const uint8_t *p = s + (size_t)y * src.wstride * 2 + (x & ~1) * 2;
+            convert(src, p[(x & 1) * 2], p[1], p[3], rgb);
+            return 0xff;
+        }
+        default:
+            rgb[0] = rgb[1] = rgb[2] = 0;
+            return 0xff;
+        }
+    }
+
+    // (x, y) 的亮度: YUV 直接取 Y，RGB 按 BT.601 加权
+    static uint8_t read_luma(const ImageBuffer &src, int x, int y)
+    {
+        const uint8_t *s = (const uint8_t *)src.virt;
+        switch (src.format)
+        {
+        case PIXEL_YUV420P:
+        case PIXEL_YUV422P:
+        case PIXEL_NV12:
+        case PIXEL_GRAY8:
+            return s[(size_t)y * src.wstride + x];
+        case PIXEL_YUYV:
+            return s[(size_t)y * src.wstride * 2 + x * 2];
+        default:
+        {
+            uint8_t rgb[3];
+            read_rgb(src, x, y, rgb);
+            return (uint8_t)((77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8);
+        }
+        }
+    }
+
+    static void convert(const ImageBuffer &src, int y, int u, int v, uint8_t *rgb)
+    {
+        if (src.yuv_range == YUV_RANGE_LIMITED)
+            yuv_limited_to_rgb(y, u, v, rgb);
+        else
+            yuv_to_rgb(y, u, v, rgb);
+    }
+};
+
+#endif
@@ -0,0 +1,363 @@
+/*******************************************************
+ * infer.h
+ * 常驻推理引擎: rknn_init / 属性查询 / io mem 绑定只做一次，
+ * 之后每帧只剩 run()；可建多套 io mem（slot）给流水线轮转
+ *******************************************************/
+#ifndef INFER_H
+#define INFER_H
+
+#include <rknn_api.h>
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+
+#include "npu_backend.h"
+
+struct InferStats
+{
+    double init_ms;   // rknn_init + 查询 + 建 mem + 绑定，只发生一次
+    double rknn_init_ms, query_ms, bind_ms; // init_ms 的分解
+    long frames;      // run() 次数
+    double run_ms;    // rknn_run 累计
+    long rebinds;     // run() 里换 slot 重新 rknn_set_io_mem 的次数
+    double rebind_ms; // 换 slot 的累计耗时
+};
+
+/*
+ * 输入按 native 布局绑定成 UINT8 NHWC（w_stride 见 input_attr()），
+ * 输出按 native NHWC 布局绑定，和 YoloDecodePlan 的假设一致。
+ * 构造失败抛 std::runtime_error。
+ */
+class Infer
+{
+public:
+    /*
+     * model_buffer / buffer_size 是内存里的模型，原样交给 backend 的 init（回放后端不读模型）；
+     * backend 为 NULL 用默认后端（真机为 librknnmrt）。
+     * bind_io 为 false 时只做 rknn_init + 属性查询，不建 io mem，
+     * 只能看属性（rknn_model_info），要推理先 create_slots。
+     */
+    Infer(const void *model_buffer, size_t buffer_size, uint32_t flags = 0,
+          NpuBackend *backend = NULL, bool bind_io = true)
+        : backend(backend ? backend : npu_default_backend())
+    {
+        memset(&stats_, 0, sizeof(stats_));
+        auto t0 = std::chrono::steady_clock::now();
+
+        // 参数 backend 可能是 NULL，下面只用成员
+        if (!this->backend)
+            throw std::runtime_error("no npu backend");
+        int ret = this->backend->init(&this->ctx, const_cast<void *>(model_buffer),
+                                (uint32_t)buffer_size, flags);
+        if (ret != RKNN_SUCC)
+        {
+            throw std::runtime_error("rknn_init failed: " + std::to_string(ret));
+        }
+        stats_.rknn_init_ms = ms_since(t0);
+
+        try
+        {
+            query_attrs();
+            query_native_attrs();
+            stats_.query_ms = ms_since(t0) - stats_.rknn_init_ms;
+            if (bind_io && (create_slots(1) != 0 || bind_slot(0) != 0))
+                throw std::runtime_error("bind io mem failed");
+            stats_.bind_ms = ms_since(t0) - stats_.rknn_init_ms - stats_.query_ms;
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+
+        stats_.init_ms = ms_since(t0);
+    }
+
+    ~Infer()
+    {
+        release();
+    }
+
+    Infer(const Infer &) = delete;
+    Infer &operator=(const Infer &) = delete;
+
+    /*
+     * 总共建 n 套输入/输出 mem（slot 0 即构造时那套），
+     * 流水线里一帧占一个 slot，NPU 跑 slot i 时别的 slot 可以被 CPU / RGA 读写
+     */
+    int create_slots(int n)
+    {
+        while ((int)slots.size() < n)
+        {
+            IoSlot s;
+            if (create_slot(&s) != 0)
+            {
+                destroy_slot(s);
+                return -1;
+            }
+            slots.push_back(s);
+        }
+        return 0;
+    }
+
+    /* ---------- 每帧 ---------- */
+    // 输入须已写进 input_mem(slot)；换 slot 时先重新 rknn_set_io_mem；返回 0 成功
+    int run(int slot = 0)
+    {
+        if (slot != bound_slot)
+        {
+            auto tb = std::chrono::steady_clock::now();
+            if (bind_slot(slot) != 0)
+                return -1;
+            stats_.rebind_ms += ms_since(tb);
+            stats_.rebinds++;
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        int ret = backend->run(ctx);
+        stats_.run_ms += std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - t0)
+                             .count();
+        stats_.frames++;
+        if (ret != RKNN_SUCC)
+        {
+            printf("rknn_run failed: %d\n", ret);
+            return -1;
+        }
+        return 0;
+    }
+
+    /* ---------- 缓存的属性 / 绑定的 mem ---------- */
+    rknn_context context() const { return ctx; }
+    int input_num() const { return (int)input_attrs.size(); }
+    int output_num() const { return (int)output_attrs.size(); }
+    int model_width() const { return model_w; }
+    int model_height() const { return model_h; }
+
+    // 绑定用的 native 属性（UINT8 NHWC，带 w_stride / size_with_stride）
+    const rknn_tensor_attr &input_attr() const { return in_native; }
+    const rknn_tensor_attr *output_native_attrs() const { return out_native.data(); }
+    int num_slots() const { return (int)slots.size(); }
+    rknn_tensor_mem *input_mem(int slot = 0) const { return slots[slot].in; }
+    rknn_tensor_mem *output_mem(int i, int slot = 0) const { return slots[slot].out[i]; }
+    // 各输出 virt_addr，直接喂给 yolo_decode
+    void *const *outputs(int slot = 0) const { return slots[slot].out_virt.data(); }
+
+    const InferStats &stats() const { return stats_; }
+
+    void print_attrs() const
+    {
+        // 输出输入属性信息
+        std::cout << "RKNN input num: " << input_attrs.size() << std::endl;
+        for (size_t i = 0; i < input_attrs.size(); ++i)
+        {
+            auto &a = input_attrs[i];
+            std::cout << "Input " << i << " shape: ";
+            for (uint32_t j = 0; j < a.n_dims; ++j)
+                std::cout << a.dims[j] << " ";
+
+            std::cout << "\n"
+                      << std::endl;
+            std::cout << "data_type=" << get_type_string(a.type) << "\n"
+                      << "data_format=" << get_format_string(a.fmt) << "\n"
+                      << "qnt_type=" << get_qnt_type_string(a.qnt_type) << "\n"
+                      << std::endl;
+        }
+
+        std::cout << "RKNN output num: " << output_attrs.size() << std::endl;
+        for (size_t i = 0; i < output_attrs.size(); ++i)
+        {
+            auto &a = output_attrs[i];
+            std::cout << "Output " << i << " shape: ";
+            for (uint32_t j = 0; j < a.n_dims; ++j)
+                std::cout << a.dims[j] << " ";
+            std::cout << std::endl;
+        }
+    }
+
+    void print_stats() const
+    {
+        printf("infer: init %.3f ms (once: rknn_init %.3f, query %.3f, bind %.3f), "
+               "%ld runs, rknn_run avg %.3f ms, %ld slot rebinds avg %.3f ms\n",
+               stats_.init_ms, stats_.rknn_init_ms, stats_.query_ms, stats_.bind_ms,
+               stats_.frames, stats_.frames ? stats_.run_ms / stats_.frames : 0.0,
+               stats_.rebinds, stats_.rebinds ? stats_.rebind_ms / stats_.rebinds : 0.0);
+    }
+
+private:
+    static double ms_since(std::chrono::steady_clock::time_point t0)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0)
+            .count();
+    }
+
+    void query_attrs()
+    {
+        // 获取输入数量 + 输入属性信息
+        rknn_input_output_num io_num;
+        int ret = backend->query(this->ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
+        if (ret != RKNN_SUCC)
+            throw std::runtime_error("RKNN_QUERY_IN_OUT_NUM failed: " + std::to_string(ret));
+
+        input_attrs.resize(io_num.n_input);
+        for (uint32_t i = 0; i < io_num.n_input; ++i)
+        {
+            rknn_tensor_attr &attr = input_attrs[i];
+            memset(&attr, 0, sizeof(attr));
+            attr.index = i;
+
+            ret = backend->query(this->ctx, RKNN_QUERY_INPUT_ATTR, &attr, sizeof(attr));
+            if (ret != RKNN_SUCC)
+                throw std::runtime_error("RKNN_QUERY_INPUT_ATTR failed: " + std::to_string(ret));
+        }
+
+        // 获取每个输出的维度信息
+        output_attrs.resize(io_num.n_output);
+        for (uint32_t i = 0; i < io_num.n_output; ++i)
+        {
+            rknn_tensor_attr &attr = output_attrs[i];
+            memset(&attr, 0, sizeof(attr));
+            attr.index = i;
+
+            ret = backend->query(this->ctx, RKNN_QUERY_OUTPUT_ATTR, &attr, sizeof(attr));
+            if (ret != RKNN_SUCC)
+                throw std::runtime_error("RKNN_QUERY_OUTPUT_ATTR failed: " + std::to_string(ret));
+        }
+    }
+
+    // 输入 / 输出的 native 属性，决定 io mem 的大小和布局
+    void query_native_attrs()
+    {
+        if (input_attrs.empty())
+            throw std::runtime_error("model has no input");
+
+        memset(&in_native, 0, sizeof(in_native));
+        in_native.index = 0;
+        int ret = backend->query(ctx, RKNN_QUERY_NATIVE_INPUT_ATTR, &in_native, sizeof(in_native));
+        if (ret != RKNN_SUCC)
+            throw std::runtime_error("RKNN_QUERY_NATIVE_INPUT_ATTR failed: " + std::to_string(ret));
+
+        // 模型输入尺寸以查询结果为准
+        if (in_native.fmt == RKNN_TENSOR_NCHW)
+        {
+            model_h = in_native.dims[2];
+            model_w = in_native.dims[3];
+        }
+        else
+        {
+            model_h = in_native.dims[1];
+            model_w = in_native.dims[2];
+        }
+
+        in_native.type = RKNN_TENSOR_UINT8;
+        in_native.fmt = RKNN_TENSOR_NHWC;
+
+        const size_t n_output = output_attrs.size();
+        out_native.resize(n_output);
+        for (size_t i = 0; i < n_output; i++)
+        {
+            rknn_tensor_attr &attr = out_native[i];
+            memset(&attr, 0, sizeof(attr));
+            attr.index = i;
+            ret = backend->query(ctx, RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR, &attr, sizeof(attr));
+            if (ret != RKNN_SUCC)
+                throw std::runtime_error("RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR failed: " +
+                                         std::to_string(ret));
+        }
+    }
+
+    /* ---------- slot ---------- */
+    struct IoSlot
+    {
+        rknn_tensor_mem *in;
+        std::vector<rknn_tensor_mem *> out;
+        std::vector<void *> out_virt;
+    };
+
+    int create_slot(IoSlot *s)
+    {
+        const size_t n_output = out_native.size();
+        s->in = backend->create_mem(ctx, in_native.size_with_stride);
+        s->out.assign(n_output, (rknn_tensor_mem *)NULL);
+        s->out_virt.assign(n_output, (void *)NULL);
+        if (!s->in)
+            return -1;
+        for (size_t i = 0; i < n_output; i++)
+        {
+            s->out[i] = backend->create_mem(ctx, out_native[i].size_with_stride);
+            if (!s->out[i])
+                return -1;
+            s->out_virt[i] = s->out[i]->virt_addr;
+        }
+        return 0;
+    }
+
+    void destroy_slot(IoSlot &s)
+    {
+        if (s.in)
+            backend->destroy_mem(ctx, s.in);
+        for (size_t i = 0; i < s.out.size(); i++)
+        {
+            if (s.out[i])
+                backend->destroy_mem(ctx, s.out[i]);
+        }
+        s.in = NULL;
+        s.out.clear();
+        s.out_virt.clear();
+    }
+
+    int bind_slot(int slot)
+    {
+        if (slot < 0 || slot >= (int)slots.size())
+            return -1;
+        IoSlot &s = slots[slot];
+        if (backend->set_io_mem(ctx, s.in, &in_native) != RKNN_SUCC)
+        {
+            printf("rknn_set_io_mem(input, slot %d) failed\n", slot);
+            return -1;
+        }
+        for (size_t i = 0; i < s.out.size(); i++)
+        {
+            if (backend->set_io_mem(ctx, s.out[i], &out_native[i]) != RKNN_SUCC)
+            {
+                printf("rknn_set_io_mem(output %zu, slot %d) failed\n", i, slot);
+                return -1;
+            }
+        }
+        bound_slot = slot;
+        return 0;
+    }
+
+    void release()
+    {
+        if (!ctx)
+            return;
+        for (size_t i = 0; i < slots.size(); i++)
+            destroy_slot(slots[i]);
+        slots.clear();
+        backend->destroy(ctx);
+        ctx = 0;
+    }
+
+    NpuBackend *backend;
+    rknn_context ctx = 0;
+    int model_w = 0;
+    int model_h = 0;
+
+    std::vector<rknn_tensor_attr> input_attrs;
+    std::vector<rknn_tensor_attr> output_attrs;
+
+    rknn_tensor_attr in_native;
+    std::vector<rknn_tensor_attr> out_native;
+    std::vector<IoSlot> slots;
+    int bound_slot = -1;
+
+    InferStats stats_;
+};
+
+#endif
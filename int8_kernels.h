@@ -0,0 +1,259 @@
+/*******************************************************
+ * int8_kernels.h
+ * int8 张量 SIMD 小核: NEON (RV1106) / SSE2 (x86 主机) / 标量
+ *******************************************************/
+#ifndef INT8_KERNELS_H
+#define INT8_KERNELS_H
+
+#include <stdint.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define INT8_KERNELS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define INT8_KERNELS_SSE2 1
+#endif
+
+/* =================== max =================== */
+// v[0..n) 的最大值，n >= 1，每次 16 lane
+static inline int8_t max_s8(const int8_t *v, int n)
+{
+    int i = 0;
+    int8_t m = -128;
+#if defined(INT8_KERNELS_NEON)
+    if (n >= 16)
+    {
+        int8x16_t acc = vld1q_s8(v);
+        for (i = 16; i + 16 <= n; i += 16)
+            acc = vmaxq_s8(acc, vld1q_s8(v + i));
+        int8x8_t r = vmax_s8(vget_low_s8(acc), vget_high_s8(acc));
+        r = vpmax_s8(r, r);
+        r = vpmax_s8(r, r);
+        r = vpmax_s8(r, r);
+        m = vget_lane_s8(r, 0);
+    }
+#elif defined(INT8_KERNELS_SSE2)
+    if (n >= 16)
+    {
+        // SSE2 只有无符号字节 max，异或 0x80 做有符号/无符号映射
+        const __m128i bias = _mm_set1_epi8((char)0x80);
+        __m128i acc = _mm_xor_si128(_mm_loadu_si128((const __m128i *)v), bias);
+        for (i = 16; i + 16 <= n; i += 16)
+            acc = _mm_max_epu8(acc, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(v + i)), bias));
+        acc = _mm_max_epu8(acc, _mm_srli_si128(acc, 8));
+        acc = _mm_max_epu8(acc, _mm_srli_si128(acc, 4));
+        acc = _mm_max_epu8(acc, _mm_srli_si128(acc, 2));
+        acc = _mm_max_epu8(acc, _mm_srli_si128(acc, 1));
+        m = (int8_t)((uint8_t)_mm_cvtsi128_si32(acc) ^ 0x80);
+    }
+#endif
+    for (; i < n; i++)
+        if (v[i] > m)
+            m = v[i];
+    return m;
+}
+
+/* =================== find =================== */
+// v[0..n) 中第一个等于 q 的下标，没有返回 -1
+static inline int find_first_s8(const int8_t *v, int n, int8_t q)
+{
+    int i = 0;
+#if defined(INT8_KERNELS_NEON)
+    const int8x16_t key = vdupq_n_s8(q);
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t eq = vceqq_s8(vld1q_s8(v + i), key);
+        uint8x8_t r = vorr_u8(vget_low_u8(eq), vget_high_u8(eq));
+        r = vpmax_u8(r, r);
+        if (vget_lane_u32(vreinterpret_u32_u8(r), 0))
+            break; // 命中的 16 字节块交给下面的标量循环定位
+    }
+#elif defined(INT8_KERNELS_SSE2)
+    const __m128i key = _mm_set1_epi8((char)q);
+    for (; i + 16 <= n; i += 16)
+    {
+        int mask = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(v + i)), key));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < n; i++)
+        if (v[i] == q)
+            return i;
+    return -1;
+}
+
+/* =================== argmax =================== */
+// 先求最大值，最大值 < min_q 的 cell 直接返回 -1，不做任何下标追踪；
+// 否则返回最大值第一次出现的下标，与标量 "v > best" 扫描结果一致。
+// min_q 用 int 传入，> 127 表示永远不通过。
+static inline int argmax_s8(const int8_t *v, int n, int min_q, int8_t *max_out)
+{
+    int8_t m = max_s8(v, n);
+    if (m < min_q)
+        return -1;
+    *max_out = m;
+    return find_first_s8(v, n, m);
+}
+
+/* =================== compact =================== */
+// 把 v[i] >= th 的下标按升序写进 idx，返回个数。idx 至少要能放 n 个。
+// 整块 16 字节都不过门限时只需一次比较，稀疏场景几乎是纯流式读。
+static inline int compact_ge_s8(const int8_t *v, int n, int8_t th, int32_t *idx)
+{
+    int i = 0, cnt = 0;
+#if defined(INT8_KERNELS_NEON)
+    static const uint8_t bit_w[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                      1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t w = vld1q_u8(bit_w);
+    const int8x16_t key = vdupq_n_s8(th);
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t ge = vcgeq_s8(vld1q_s8(v + i), key);
+        uint8x8_t any = vorr_u8(vget_low_u8(ge), vget_high_u8(ge));
+        any = vpmax_u8(any, any);
+        if (!vget_lane_u32(vreinterpret_u32_u8(any), 0))
+            continue;
+
+        // 16 个比较结果压成 16 bit 掩码
+        uint8x16_t bits = vandq_u8(ge, w);
+        uint8x8_t s = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+        s = vpadd_u8(s, s);
+        s = vpadd_u8(s, s);
+        uint32_t mask = vget_lane_u8(s, 0) | ((uint32_t)vget_lane_u8(s, 1) << 8);
+        while (mask)
+        {
+            idx[cnt++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#elif defined(INT8_KERNELS_SSE2)
+    const __m128i key = _mm_set1_epi8((char)th);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i lt = _mm_cmplt_epi8(_mm_loadu_si128((const __m128i *)(v + i)), key);
+        uint32_t mask = ~_mm_movemask_epi8(lt) & 0xFFFF;
+        while (mask)
+        {
+            idx[cnt++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < n; i++)
+        if (v[i] >= th)
+            idx[cnt++] = i;
+    return cnt;
+}
+
+// compact_ge_s8 的 uint8 版本（uint8 量化输出用）
+static inline int compact_ge_u8(const uint8_t *v, int n, uint8_t th, int32_t *idx)
+{
+    int i = 0, cnt = 0;
+#if defined(INT8_KERNELS_NEON)
+    static const uint8_t bit_w[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                      1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t w = vld1q_u8(bit_w);
+    const uint8x16_t key = vdupq_n_u8(th);
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t ge = vcgeq_u8(vld1q_u8(v + i), key);
+        uint8x8_t any = vorr_u8(vget_low_u8(ge), vget_high_u8(ge));
+        any = vpmax_u8(any, any);
+        if (!vget_lane_u32(vreinterpret_u32_u8(any), 0))
+            continue;
+
+        uint8x16_t bits = vandq_u8(ge, w);
+        uint8x8_t s = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+        s = vpadd_u8(s, s);
+        s = vpadd_u8(s, s);
+        uint32_t mask = vget_lane_u8(s, 0) | ((uint32_t)vget_lane_u8(s, 1) << 8);
+        while (mask)
+        {
+            idx[cnt++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#elif defined(INT8_KERNELS_SSE2)
+    // 无符号 v >= th 等价于 max(v, th) == v
+    const __m128i key = _mm_set1_epi8((char)th);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(v + i));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, key), x));
+        while (mask)
+        {
+            idx[cnt++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < n; i++)
+        if (v[i] >= th)
+            idx[cnt++] = i;
+    return cnt;
+}
+
+/* =================== SAD =================== */
+/*
+ * 两幅 w x h 的 uint8 图（行跨度都是 w）按 8x8 分块求绝对差之和，
+ * sums[(y / 8) * (w / 8) + x / 8]。w、h 须是 8 的倍数。
+ */
+static inline void sad_8x8_u8(const uint8_t *a, const uint8_t *b, int w, int h, uint32_t *sums)
+{
+    const int bw = w / 8;
+    for (int by = 0; by < h / 8; by++)
+    {
+        const uint8_t *pa = a + (size_t)by * 8 * w;
+        const uint8_t *pb = b + (size_t)by * 8 * w;
+        uint32_t *out = sums + by * bw;
+        int x = 0;
+#if defined(INT8_KERNELS_NEON)
+        // 每次两个块: 8 行 |a-b| 累加进 u16（最大 8 * 255），再横向加
+        for (; x + 16 <= w; x += 16)
+        {
+            uint16x8_t lo = vdupq_n_u16(0), hi = vdupq_n_u16(0);
+            for (int r = 0; r < 8; r++)
+            {
+                uint8x16_t va = vld1q_u8(pa + r * w + x);
+                uint8x16_t vb = vld1q_u8(pb + r * w + x);
+                lo = vabal_u8(lo, vget_low_u8(va), vget_low_u8(vb));
+                hi = vabal_u8(hi, vget_high_u8(va), vget_high_u8(vb));
+            }
+            uint64x2_t sl = vpaddlq_u32(vpaddlq_u16(lo));
+            uint64x2_t sh = vpaddlq_u32(vpaddlq_u16(hi));
+            out[x / 8] = (uint32_t)(vgetq_lane_u64(sl, 0) + vgetq_lane_u64(sl, 1));
+            out[x / 8 + 1] = (uint32_t)(vgetq_lane_u64(sh, 0) + vgetq_lane_u64(sh, 1));
+        }
+#elif defined(INT8_KERNELS_SSE2)
+        // psadbw 一行 16 字节直接给出左右两块各 8 字节的和
+        for (; x + 16 <= w; x += 16)
+        {
+            __m128i acc = _mm_setzero_si128();
+            for (int r = 0; r < 8; r++)
+            {
+                __m128i va = _mm_loadu_si128((const __m128i *)(pa + r * w + x));
+                __m128i vb = _mm_loadu_si128((const __m128i *)(pb + r * w + x));
+                acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+            }
+            out[x / 8] = (uint32_t)_mm_cvtsi128_si32(acc);
+            out[x / 8 + 1] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+        }
+#endif
+        for (; x < w; x += 8)
+        {
+            uint32_t sum = 0;
+            for (int r = 0; r < 8; r++)
+                for (int c = 0; c < 8; c++)
+                {
+                    int d = (int)pa[r * w + x + c] - (int)pb[r * w + x + c];
+                    sum += d < 0 ? -d : d;
+                }
+            out[x / 8] = sum;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,160 @@
+/*******************************************************
+ * jpeg_decoder.h
+ * libjpeg-turbo 解码封装: 按模型输入挑 DCT 域缩放系数
+ *******************************************************/
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <turbojpeg.h>
+
+#include "image_ops.h"
+
+struct JpegInfo
+{
+    int width, height;   // 原始尺寸
+    int subsamp, colorspace;
+};
+
+/*
+ * 在 libjpeg-turbo 支持的缩放系数 (<= 1) 里挑缩小得最多、但缩放后仍
+ * >= min_w x min_h 的那个，写回缩放后的尺寸。解码耗时和缓冲大小因此
+ * 跟着模型输入走，而不是跟着传感器分辨率走。
+ */
+static inline void jpeg_pick_scale(int img_w, int img_h, int min_w, int min_h,
+                                   int *out_w, int *out_h)
+{
+    *out_w = img_w;
+    *out_h = img_h;
+
+    int n = 0;
+    tjscalingfactor *sf = tjGetScalingFactors(&n);
+    for (int i = 0; sf && i < n; i++)
+    {
+        if (sf[i].num > sf[i].denom)
+            continue;
+        int w = TJSCALED(img_w, sf[i]);
+        int h = TJSCALED(img_h, sf[i]);
+        if (w >= min_w && h >= min_h && w * h < *out_w * *out_h)
+        {
+            *out_w = w;
+            *out_h = h;
+        }
+    }
+}
+
+/* =================== 解码输出布局 =================== */
+enum JpegIngest
+{
+    JPEG_INGEST_RGBA = 0, // tjDecompress2 -> RGBA，4 字节/像素
+    JPEG_INGEST_YUV,      // tjDecompressToYUVPlanes -> 平面 YUV，交给 RGA 做缩放 + CSC
+};
+
+// 解码缓冲的格式和尺寸，ImageBuffer 直接按它描述
+struct JpegLayout
+{
+    int decode_w, decode_h; // 交给 libjpeg-turbo 的缩放后尺寸
+    int width, height;      // 有效图像尺寸（YUV 取偶）
+    int wstride, hstride;
+    int format;
+    size_t size;
+};
+
+/*
+ * out_w x out_h 为 jpeg_pick_scale 选出的缩放后尺寸。
+ * YUV 模式只接 4:2:0 / 4:2:2（RGA 能直接读的平面格式），宽高取偶、
+ * wstride 按 16 对齐；其他采样方式（4:4:4、灰度等）退回 RGBA。
+ */
+static inline JpegLayout jpeg_layout(const JpegInfo &info, int out_w, int out_h, int ingest)
+{
+    JpegLayout l;
+    l.decode_w = out_w;
+    l.decode_h = out_h;
+    if (ingest == JPEG_INGEST_YUV &&
+        (info.subsamp == TJSAMP_420 || info.subsamp == TJSAMP_422))
+    {
+        l.format = info.subsamp == TJSAMP_420 ? PIXEL_YUV420P : PIXEL_YUV422P;
+        l.width = out_w & ~1;
+        l.height = out_h & ~1;
+        l.wstride = (out_w + 15) & ~15;
+        l.hstride = (out_h + 1) & ~1;
+    }
+    else
+    {
+        l.format = PIXEL_RGBA8888;
+        l.width = l.wstride = out_w;
+        l.height = l.hstride = out_h;
+    }
+    l.size = pixel_buffer_size(l.format, l.wstride, l.hstride);
+    return l;
+}
+
+class JpegDecoder
+{
+public:
+    JpegDecoder() : handle(tjInitDecompress()) {}
+
+    ~JpegDecoder()
+    {
+        if (handle)
+            tjDestroy(handle);
+    }
+
+    JpegDecoder(const JpegDecoder &) = delete;
+    JpegDecoder &operator=(const JpegDecoder &) = delete;
+
+    int read_header(const unsigned char *jpg, unsigned long size, JpegInfo *info)
+    {
+        if (!handle ||
+            tjDecompressHeader3(handle, jpg, size, &info->width, &info->height,
+                                &info->subsamp, &info->colorspace) != 0)
+        {
+            printf("tjDecompressHeader3 failed: %s\n", tjGetErrorStr());
+            return -1;
+        }
+        return 0;
+    }
+
+    // 解码成 out_w x out_h RGBA，尺寸须来自 jpeg_pick_scale（或原始尺寸）
+    int decode_rgba(const unsigned char *jpg, unsigned long size,
+                    uint8_t *dst, int out_w, int out_h, int pitch)
+    {
+        if (tjDecompress2(handle, jpg, size, dst, out_w, pitch, out_h,
+                          TJPF_RGBA, TJFLAG_FASTDCT) != 0)
+        {
+            printf("tjDecompress2 failed: %s\n", tjGetErrorStr());
+            return -1;
+        }
+        return 0;
+    }
+
+    // 按 jpeg_layout 的布局解码进 dst（至少 l.size 字节）
+    int decode(const unsigned char *jpg, unsigned long size, const JpegLayout &l, uint8_t *dst)
+    {
+        if (l.format == PIXEL_RGBA8888)
+            return decode_rgba(jpg, size, dst, l.width, l.height, l.wstride * 4);
+
+        // 平面按 wstride x hstride 排布，和 RGA 的 YCbCr_42x_P 一致
+        const size_t luma = (size_t)l.wstride * l.hstride;
+        const int ch = l.format == PIXEL_YUV420P ? l.hstride / 2 : l.hstride;
+        unsigned char *planes[3] = {dst, dst + luma, dst + luma + (size_t)(l.wstride / 2) * ch};
+        int strides[3] = {l.wstride, l.wstride / 2, l.wstride / 2};
+
+        // 宽高传缩放后的原尺寸，让 libjpeg-turbo 选到同一个缩放系数；
+        // 奇数边多出的一行/列落在 stride 余量里
+        if (tjDecompressToYUVPlanes(handle, jpg, size, planes, l.decode_w,
+                                    strides, l.decode_h, TJFLAG_FASTDCT) != 0)
+        {
+            printf("tjDecompressToYUVPlanes failed: %s\n", tjGetErrorStr());
+            return -1;
+        }
+        return 0;
+    }
+
+private:
+    tjhandle handle;
+};
+
+#endif
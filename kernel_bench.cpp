@@ -0,0 +1,457 @@
+/*******************************************************
+ * kernel_bench.cpp
+ * 热点核的微基准: DFL、单分支解码、整帧解码、NMS、letterbox、
+ * MobileNet 分类头、JPEG 解码。输入全是合成数据，候选密度可控
+ * （空场景到人群），结果以 JSON 输出，方便跨提交 / x86 与 ARM 对比。
+ *
+ * 用法: kernel_bench [--iters N] [--filter 子串] [--out result.json]
+ *******************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "yolov8_postprocess.h"
+#include "synth_yolo.h"
+#include "letterbox.h"
+#include "preprocess.h"
+#include "classifier_head.h"
+#ifndef KERNEL_BENCH_NO_JPEG
+#include "jpeg_decoder.h"
+#endif
+
+/* =================== 计时 =================== */
+struct BenchResult
+{
+    std::string kernel, name;
+    long items;      // 每次调用处理的元素数（cell / 候选 / 像素）
+    long candidates; // 解码 / NMS 的候选数，其余为 -1
+    int iters;
+    double min_us, median_us, mean_us, p95_us;
+};
+
+struct BenchConfig
+{
+    int min_iters;
+    double min_ms; // 每个用例至少跑这么久
+    const char *filter;
+};
+
+static std::vector<BenchResult> g_results;
+static volatile float g_sink; // 防止结果被优化掉
+
+static bool bench_enabled(const BenchConfig &cfg, const std::string &kernel)
+{
+    return !cfg.filter || kernel.find(cfg.filter) != std::string::npos;
+}
+
+// fn 先热身 3 次，再至少跑 min_iters 次且累计 min_ms
+template <typename Fn>
+static void bench(const BenchConfig &cfg, const std::string &kernel, const std::string &name,
+                  long items, long candidates, Fn fn)
+{
+    if (!bench_enabled(cfg, kernel))
+        return;
+    for (int i = 0; i < 3; i++)
+        fn();
+
+    std::vector<double> us;
+    double total = 0;
+    while ((int)us.size() < cfg.min_iters || (total < cfg.min_ms * 1000 && us.size() < 100000))
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        double t = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0)
+                       .count();
+        us.push_back(t);
+        total += t;
+    }
+    std::sort(us.begin(), us.end());
+
+    BenchResult r;
+    r.kernel = kernel;
+    r.name = name;
+    r.items = items;
+    r.candidates = candidates;
+    r.iters = (int)us.size();
+    r.min_us = us.front();
+    r.median_us = us[us.size() / 2];
+    r.mean_us = total / us.size();
+    r.p95_us = us[(us.size() * 95) / 100];
+    g_results.push_back(r);
+    fprintf(stderr, "%-18s %-28s %10.2f us (median, %d iters)\n",
+            kernel.c_str(), name.c_str(), r.median_us, r.iters);
+}
+
+static const double kDensities[] = {0.0, 0.001, 0.01, 0.05, 0.25};
+
+static std::string density_name(const char *prefix, double d)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "density=%.3f", d);
+    return std::string(prefix) + buf;
+}
+
+static void bench_dfl(const BenchConfig &cfg)
+{
+    const int n = 8400;
+    SynthYolo m;
+    m.build(0.0, true, 1);
+    DflTable t;
+    t.init(m.attrs[0]);
+    std::vector<int8_t> box(n * 64);
+    for (size_t i = 0; i < box.size(); i++)
+        box[i] = (int8_t)(rand() % 160 - 100);
+    std::vector<float> dist(4);
+
+    bench(cfg, "compute_dfl", "dl=16/simd", n, -1, [&]()
+          {
+              float s = 0;
+              for (int i = 0; i < n; i++)
+              {
+                  compute_dfl<16>(&box[i * 64], t, 16, dist.data());
+                  s += dist[0];
+              }
+              g_sink = s; });
+    bench(cfg, "compute_dfl", "dl=16/scalar", n, -1, [&]()
+          {
+              float s = 0;
+              for (int i = 0; i < n; i++)
+              {
+                  compute_dfl<0>(&box[i * 64], t, 16, dist.data());
+                  s += dist[0];
+              }
+              g_sink = s; });
+}
+
+static void bench_decode_nms(const BenchConfig &cfg)
+{
+    for (int with_sum = 1; with_sum >= 0; with_sum--)
+    {
+        for (size_t di = 0; di < sizeof(kDensities) / sizeof(kDensities[0]); di++)
+        {
+            const double d = kDensities[di];
+            SynthYolo m;
+            m.build(d, with_sum != 0, 1234 + di);
+            YoloDecodePlan plan;
+            if (plan.compile(m.attrs.data(), m.attrs.size(), 640, 640, 0.25f) != 0)
+                return;
+            YoloCandidates cand;
+            cand.reserve(plan.capacity());
+            void *const *outs = m.outputs.data();
+            const char *prefix = with_sum ? "" : "nosum/";
+
+            // 单分支只在有 score_sum 的模型上测，分支间差别主要是 grid 大小
+            if (with_sum)
+            {
+                for (size_t b = 0; b < plan.branch.size(); b++)
+                {
+                    const YoloBranchPlan &br = plan.branch[b];
+                    cand.clear();
+                    br.kernel(br, outs, cand);
+                    char name[64];
+                    snprintf(name, sizeof(name), "grid=%d/", br.gw);
+                    bench(cfg, "process_branch", density_name(name, d), br.gh * br.gw, cand.count,
+                          [&]()
+                          {
+                              cand.clear();
+                              br.kernel(br, outs, cand); });
+                }
+            }
+
+            cand.clear();
+            yolo_decode(plan, outs, cand);
+            bench(cfg, "yolo_decode", density_name(prefix, d), plan.capacity(), cand.count, [&]()
+                  {
+                      cand.clear();
+                      yolo_decode(plan, outs, cand); });
+
+            // NMS 只读候选列，同一份候选可以反复跑
+            if (with_sum)
+            {
+                NmsEngine nms(0.45f, 300);
+                nms.reserve(plan.capacity(), plan.num_classes);
+                bench(cfg, "nms", density_name("", d), cand.count, cand.count, [&]()
+                      {
+                          yolo_nms(nms, cand);
+                          g_sink = (float)cand.nkeep; });
+            }
+        }
+    }
+}
+
+static void bench_letterbox(const BenchConfig &cfg)
+{
+    const int dst_w = 640, dst_h = 640;
+    std::vector<uint8_t> tensor(dst_w * dst_h * 3);
+
+    // 已缩放好的 RGBA 直接拷进张量（RGA 输出之后的那一步）
+    static const int sizes[][2] = {{640, 360}, {640, 480}, {480, 640}};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        const int w = sizes[i][0], h = sizes[i][1];
+        std::vector<uint8_t> src(w * h * 4);
+        for (size_t k = 0; k < src.size(); k++)
+            src[k] = (uint8_t)(k * 131 + 7);
+        char name[64];
+        snprintf(name, sizeof(name), "copy/%dx%d", w, h);
+        bench(cfg, "letterbox", name, dst_w * dst_h, -1, [&]()
+              { letterbox_rgba_to_rgb(src.data(), w, h, w * 4, tensor.data(), dst_w, dst_h,
+                                      dst_w * 3, (dst_w - w) / 2, (dst_h - h) / 2,
+                                      LETTERBOX_FILL); });
+    }
+
+    // 单趟缩放 + 填边，SoftImageOps 代替 RGA
+    SoftImageOps soft_ops;
+    std::vector<uint8_t> src(1280 * 720 * 4);
+    for (size_t k = 0; k < src.size(); k++)
+        src[k] = (uint8_t)(k * 131 + 7);
+    ImageBuffer src_img = make_image_buffer(-1, src.data(), 1280, 720, PIXEL_RGBA8888);
+    ImageBuffer dst_img = make_image_buffer(-1, tensor.data(), dst_w, dst_h, PIXEL_RGB888);
+    bench(cfg, "letterbox", "soft_resize/1280x720", dst_w * dst_h, -1, [&]()
+          { letterbox_into(soft_ops, src_img, dst_img, NULL); });
+}
+
+/* =================== MobileNet 分类头 =================== */
+// rknn_mobilenet_infer_demo.cpp 的第 9 步原样搬过来: 整张量反量化 + softmax + partial_sort
+static void mobilenet_head_legacy(const int8_t *p, int n, int32_t zp, float scale,
+                                  int *top_cls, float *top_prob)
+{
+    std::vector<float> logits(n);
+    for (int i = 0; i < n; ++i)
+        logits[i] = (p[i] - zp) * scale;
+
+    float maxv = logits[0];
+    for (auto v : logits)
+        if (v > maxv)
+            maxv = v;
+
+    std::vector<float> probs(logits.size());
+    float sum = 0.f;
+    for (size_t i = 0; i < logits.size(); ++i)
+    {
+        probs[i] = expf(logits[i] - maxv);
+        sum += probs[i];
+    }
+    for (auto &x : probs)
+        x /= (sum + 1e-9f);
+
+    std::vector<std::pair<int, float> > vec;
+    vec.reserve(probs.size());
+    for (int i = 0; i < (int)probs.size(); ++i)
+        vec.emplace_back(i, probs[i]);
+    std::partial_sort(vec.begin(), vec.begin() + 5, vec.end(),
+                      [](const std::pair<int, float> &a, const std::pair<int, float> &b)
+                      { return a.second > b.second; });
+    for (int i = 0; i < 5; ++i)
+    {
+        top_cls[i] = vec[i].first;
+        top_prob[i] = vec[i].second;
+    }
+}
+
+static void bench_mobilenet_head(const BenchConfig &cfg)
+{
+    const int n = 1001;
+    const int32_t zp = -14;
+    const float scale = 0.08f;
+    std::vector<int8_t> logits(n);
+    for (int i = 0; i < n; i++)
+        logits[i] = (int8_t)(rand() % 60 - 40);
+    for (int i = 0; i < 5; i++)
+        logits[rand() % n] = (int8_t)(80 + i * 8);
+
+    int top_cls[5];
+    float top_prob[5];
+    bench(cfg, "mobilenet_head", "legacy/n=1001", n, -1, [&]()
+          {
+              mobilenet_head_legacy(logits.data(), n, zp, scale, top_cls, top_prob);
+              g_sink = top_prob[0]; });
+
+    rknn_tensor_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = RKNN_TENSOR_INT8;
+    attr.n_elems = n;
+    attr.zp = zp;
+    attr.scale = scale;
+    ClassifierHead head;
+    if (head.init(attr, 5) != 0)
+        return;
+    ClassScore top[5];
+    bench(cfg, "mobilenet_head", "quantized/n=1001", n, -1, [&]()
+          {
+              head.run(logits.data(), top);
+              g_sink = top[0].prob; });
+}
+
+/* =================== JPEG =================== */
+#ifndef KERNEL_BENCH_NO_JPEG
+// 合成一张带渐变和噪声的图编码成 4:2:0 JPEG，压缩率接近真实照片
+static int synth_jpeg(int w, int h, std::vector<unsigned char> &out)
+{
+    std::vector<uint8_t> rgb(w * h * 3);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            uint8_t *p = &rgb[(y * w + x) * 3];
+            p[0] = (uint8_t)(x * 255 / w + rand() % 16);
+            p[1] = (uint8_t)(y * 255 / h + rand() % 16);
+            p[2] = (uint8_t)(((x / 32 + y / 32) & 1) * 128 + rand() % 32);
+        }
+
+    tjhandle enc = tjInitCompress();
+    if (!enc)
+        return -1;
+    unsigned char *jpg = NULL;
+    unsigned long size = 0;
+    int ret = tjCompress2(enc, rgb.data(), w, w * 3, h, TJPF_RGB, &jpg, &size,
+                          TJSAMP_420, 90, 0);
+    if (ret == 0)
+        out.assign(jpg, jpg + size);
+    if (jpg)
+        tjFree(jpg);
+    tjDestroy(enc);
+    return ret;
+}
+
+static void bench_jpeg(const BenchConfig &cfg)
+{
+    if (!bench_enabled(cfg, "jpeg_decode"))
+        return;
+    static const int sizes[][2] = {{320, 240}, {640, 480}, {1280, 720}, {1920, 1080}};
+    JpegDecoder jpeg;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        const int w = sizes[i][0], h = sizes[i][1];
+        std::vector<unsigned char> jpg;
+        if (synth_jpeg(w, h, jpg) != 0)
+        {
+            fprintf(stderr, "jpeg encode %dx%d failed\n", w, h);
+            continue;
+        }
+        JpegInfo info;
+        if (jpeg.read_header(jpg.data(), jpg.size(), &info) != 0)
+            continue;
+
+        char name[64];
+        std::vector<uint8_t> full(w * h * 4);
+        snprintf(name, sizeof(name), "rgba_full/%dx%d", w, h);
+        bench(cfg, "jpeg_decode", name, (long)w * h, -1, [&]()
+              { jpeg.decode_rgba(jpg.data(), jpg.size(), full.data(), w, h, w * 4); });
+
+        // demo 实际走的路径: 按 640x640 letterbox 选 DCT 缩放后解码
+        LetterboxInfo lb = letterbox_info(w, h, 640, 640);
+        int dec_w, dec_h;
+        jpeg_pick_scale(w, h, lb.resize_w, lb.resize_h, &dec_w, &dec_h);
+        static const int ingest[2] = {JPEG_INGEST_RGBA, JPEG_INGEST_YUV};
+        static const char *ingest_name[2] = {"rgba_scaled", "yuv_scaled"};
+        for (int k = 0; k < 2; k++)
+        {
+            JpegLayout l = jpeg_layout(info, dec_w, dec_h, ingest[k]);
+            std::vector<uint8_t> buf(l.size);
+            snprintf(name, sizeof(name), "%s/%dx%d", ingest_name[k], w, h);
+            bench(cfg, "jpeg_decode", name, (long)l.width * l.height, -1, [&]()
+                  { jpeg.decode(jpg.data(), jpg.size(), l, buf.data()); });
+        }
+    }
+}
+#endif
+
+/* =================== JSON =================== */
+static const char *bench_arch()
+{
+#if defined(__aarch64__)
+    return "aarch64";
+#elif defined(__arm__)
+    return "arm";
+#elif defined(__x86_64__)
+    return "x86_64";
+#else
+    return "unknown";
+#endif
+}
+
+static const char *bench_simd()
+{
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return "neon";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+static void write_json(FILE *fp, const BenchConfig &cfg)
+{
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"bench\": \"kernel_bench\",\n");
+    fprintf(fp, "  \"arch\": \"%s\",\n", bench_arch());
+    fprintf(fp, "  \"simd\": \"%s\",\n", bench_simd());
+    fprintf(fp, "  \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(fp, "  \"min_iters\": %d,\n", cfg.min_iters);
+    fprintf(fp, "  \"results\": [\n");
+    for (size_t i = 0; i < g_results.size(); i++)
+    {
+        const BenchResult &r = g_results[i];
+        fprintf(fp, "    {\"kernel\": \"%s\", \"case\": \"%s\", \"items\": %ld, ",
+                r.kernel.c_str(), r.name.c_str(), r.items);
+        if (r.candidates >= 0)
+            fprintf(fp, "\"candidates\": %ld, ", r.candidates);
+        fprintf(fp, "\"iters\": %d, \"min_us\": %.3f, \"median_us\": %.3f, "
+                    "\"mean_us\": %.3f, \"p95_us\": %.3f, \"ns_per_item\": %.3f}%s\n",
+                r.iters, r.min_us, r.median_us, r.mean_us, r.p95_us,
+                r.items > 0 ? r.median_us * 1000.0 / r.items : 0.0,
+                i + 1 < g_results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig cfg;
+    cfg.min_iters = 20;
+    cfg.min_ms = 100;
+    cfg.filter = NULL;
+    const char *out_path = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc)
+            cfg.min_iters = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            cfg.filter = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out_path = argv[++i];
+        else
+        {
+            printf("Usage: %s [--iters N] [--filter kernel] [--out result.json]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (cfg.min_iters <= 0)
+        cfg.min_iters = 1;
+
+    bench_dfl(cfg);
+    bench_decode_nms(cfg);
+    bench_letterbox(cfg);
+    bench_mobilenet_head(cfg);
+#ifndef KERNEL_BENCH_NO_JPEG
+    bench_jpeg(cfg);
+#endif
+
+    FILE *fp = out_path ? fopen(out_path, "w") : stdout;
+    if (!fp)
+    {
+        printf("open %s failed\n", out_path);
+        return -1;
+    }
+    write_json(fp, cfg);
+    if (out_path)
+        fclose(fp);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*******************************************************
+ * letterbox.h
+ * letterbox: RGBA -> RGB 去交织拷贝 + 只填充边带
+ *******************************************************/
+#ifndef LETTERBOX_H
+#define LETTERBOX_H
+
+#include <stdint.h>
+#include <string.h>
+
+// x86-64 默认只有 SSE2；-mssse3 等开了 SSSE3 时用一条 pshufb
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LETTERBOX_NEON 1
+#define LETTERBOX_SIMD "neon"
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define LETTERBOX_SSSE3 1
+#define LETTERBOX_SIMD "ssse3"
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LETTERBOX_SSE2 1
+#define LETTERBOX_SIMD "sse2"
+#else
+#define LETTERBOX_SIMD "scalar"
+#endif
+
+#define LETTERBOX_FILL 114
+
+/* =================== RGBA -> RGB =================== */
+// 一行 w 个像素，丢掉 alpha
+static inline void rgba_to_rgb_row(const uint8_t *src, uint8_t *dst, int w)
+{
+    int x = 0;
+#if defined(LETTERBOX_NEON)
+    for (; x + 16 <= w; x += 16)
+    {
+        uint8x16x4_t px = vld4q_u8(src + x * 4);
+        uint8x16x3_t rgb;
+        rgb.val[0] = px.val[0];
+        rgb.val[1] = px.val[1];
+        rgb.val[2] = px.val[2];
+        vst3q_u8(dst + x * 3, rgb);
+    }
+#elif defined(LETTERBOX_SSSE3)
+    // 每次 4 像素 16 字节 -> 12 字节；16 字节写回的尾巴由下一次覆盖，
+    // 循环条件保证最后一次写也不越过本行
+    const __m128i shuf = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    for (; x + 6 <= w; x += 4)
+    {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + x * 4));
+        _mm_storeu_si128((__m128i *)(dst + x * 3), _mm_shuffle_epi8(px, shuf));
+    }
+#elif defined(LETTERBOX_SSE2)
+    // 没有 pshufb: 每个 64 位里把奇数像素右移 8 位贴到偶数像素后面（6 字节），
+    // 再把高 64 位的 6 字节拼到第 6 字节处；写回方式和 SSSE3 路径相同
+    const __m128i even = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+    const __m128i odd = _mm_set_epi32(0x00FFFFFF, 0, 0x00FFFFFF, 0);
+    for (; x + 6 <= w; x += 4)
+    {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + x * 4));
+        __m128i t = _mm_or_si128(_mm_and_si128(px, even),
+                                 _mm_srli_epi64(_mm_and_si128(px, odd), 8));
+        __m128i rgb = _mm_or_si128(_mm_move_epi64(t), _mm_slli_si128(_mm_srli_si128(t, 8), 6));
+        _mm_storeu_si128((__m128i *)(dst + x * 3), rgb);
+    }
+#endif
+    for (; x < w; x++)
+    {
+        dst[x * 3 + 0] = src[x * 4 + 0];
+        dst[x * 3 + 1] = src[x * 4 + 1];
+        dst[x * 3 + 2] = src[x * 4 + 2];
+    }
+}
+
+/* =================== 边带填充 =================== */
+// 只填 (x, y, w, h) 矩形之外的部分: 上下整行 + 中间行的左右两段
+static inline void letterbox_fill_border(uint8_t *dst, int dst_w, int dst_h, int dst_stride,
+                                         int bpp, int x, int y, int w, int h, uint8_t value)
+{
+    for (int r = 0; r < y; r++)
+        memset(dst + r * dst_stride, value, dst_w * bpp);
+    for (int r = y; r < y + h; r++)
+    {
+        uint8_t *row = dst + r * dst_stride;
+        if (x > 0)
+            memset(row, value, x * bpp);
+        if (x + w < dst_w)
+            memset(row + (x + w) * bpp, value, (dst_w - x - w) * bpp);
+    }
+    for (int r = y + h; r < dst_h; r++)
+        memset(dst + r * dst_stride, value, dst_w * bpp);
+}
+
+/* =================== letterbox =================== */
+// src: src_w x src_h RGBA，行跨度 src_stride 字节
+// dst: dst_w x dst_h RGB，行跨度 dst_stride 字节，图像放在 (pad_x, pad_y)
+static inline void letterbox_rgba_to_rgb(const uint8_t *src, int src_w, int src_h, int src_stride,
+                                         uint8_t *dst, int dst_w, int dst_h, int dst_stride,
+                                         int pad_x, int pad_y, uint8_t fill)
+{
+    letterbox_fill_border(dst, dst_w, dst_h, dst_stride, 3,
+                          pad_x, pad_y, src_w, src_h, fill);
+    for (int y = 0; y < src_h; y++)
+        rgba_to_rgb_row(src + y * src_stride,
+                        dst + (y + pad_y) * dst_stride + pad_x * 3, src_w);
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*******************************************************
+ * letterbox_bench.cpp
+ * 主机上对比 letterbox: 原逐像素循环 vs letterbox.h
+ * 以及 preprocess.h 单趟路径（SoftImageOps 代替 RGA）
+ *******************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+#include "letterbox.h"
+#include "preprocess.h"
+
+// rknn_yolov8s_infer_demo.cpp 原来的第 7 步: 整块 memset + 逐像素拷贝
+static void letterbox_legacy(const uint8_t *src_rgba, int resize_w, int resize_h,
+                             uint8_t *dst_rgb, int dst_w, int dst_h, int pad_x, int pad_y)
+{
+    memset(dst_rgb, 114, dst_w * dst_h * 3);
+    for (int y = 0; y < resize_h; y++)
+    {
+        for (int x = 0; x < resize_w; x++)
+        {
+            const uint8_t *s = src_rgba + (y * resize_w + x) * 4;
+            uint8_t *d = dst_rgb + ((y + pad_y) * dst_w + (x + pad_x)) * 3;
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int resize_w = argc > 1 ? atoi(argv[1]) : 640;
+    int resize_h = argc > 2 ? atoi(argv[2]) : 360;
+    int iters = argc > 3 ? atoi(argv[3]) : 200;
+    const int dst_w = 640, dst_h = 640;
+
+    if (resize_w <= 0 || resize_h <= 0 || resize_w > dst_w || resize_h > dst_h || iters <= 0)
+    {
+        printf("Usage: %s [resize_w<=640] [resize_h<=640] [iters]\n", argv[0]);
+        return -1;
+    }
+
+    int pad_x = (dst_w - resize_w) / 2;
+    int pad_y = (dst_h - resize_h) / 2;
+
+    std::vector<uint8_t> src(resize_w * resize_h * 4);
+    for (size_t i = 0; i < src.size(); i++)
+        src[i] = (uint8_t)(i * 131 + 7);
+    std::vector<uint8_t> ref(dst_w * dst_h * 3), out(dst_w * dst_h * 3);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iters; i++)
+        letterbox_legacy(src.data(), resize_w, resize_h, ref.data(), dst_w, dst_h, pad_x, pad_y);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iters; i++)
+        letterbox_rgba_to_rgb(src.data(), resize_w, resize_h, resize_w * 4,
+                              out.data(), dst_w, dst_h, dst_w * 3,
+                              pad_x, pad_y, LETTERBOX_FILL);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    // 单趟路径: 源图直接 letterbox 进"输入张量"，这里用 SoftImageOps + 普通内存代替
+    // RGA 和 rknn_create_mem；源图尺寸已是缩放后尺寸时输出应与上面逐字节一致
+    SoftImageOps soft_ops;
+    std::vector<uint8_t> tensor(dst_w * dst_h * 3);
+    ImageBuffer src_img = make_image_buffer(-1, src.data(), resize_w, resize_h, PIXEL_RGBA8888);
+    ImageBuffer dst_img = make_image_buffer(-1, tensor.data(), dst_w, dst_h, PIXEL_RGB888);
+    LetterboxInfo lb;
+    for (int i = 0; i < iters; i++)
+        letterbox_into(soft_ops, src_img, dst_img, &lb);
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    if (memcmp(ref.data(), out.data(), ref.size()) != 0)
+    {
+        printf("letterbox mismatch!\n");
+        return -1;
+    }
+    if (lb.resize_w == resize_w && lb.resize_h == resize_h &&
+        memcmp(ref.data(), tensor.data(), ref.size()) != 0)
+    {
+        printf("single-pass letterbox mismatch!\n");
+        return -1;
+    }
+
+    double legacy_ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / iters;
+    double fast_ms = std::chrono::duration<double, std::milli>(t2 - t1).count() / iters;
+    printf("letterbox %dx%d -> %dx%d, %d iters, %s\n", resize_w, resize_h, dst_w, dst_h, iters,
+           LETTERBOX_SIMD);
+    double single_ms = std::chrono::duration<double, std::milli>(t3 - t2).count() / iters;
+    printf("legacy: %.3f ms, letterbox.h: %.3f ms, speedup: %.2fx\n",
+           legacy_ms, fast_ms, legacy_ms / fast_ms);
+    printf("single-pass (soft ops): %.3f ms\n", single_ms);
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*******************************************************
+ * model_file.h
+ * .rknn 模型文件只读 mmap 给 rknn_init，不再 malloc + fread 整份拷贝；
+ * rknn_init 返回后运行时已把模型搬进自己的内存，release() 立刻解除映射。
+ * 映射页是干净的文件页，内存紧时内核可以直接丢，不算进匿名内存。
+ *******************************************************/
+#ifndef MODEL_FILE_H
+#define MODEL_FILE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+struct ModelFileStats
+{
+    double open_ms; // open + fstat
+    double map_ms;  // mmap + madvise
+};
+
+class ModelFile
+{
+public:
+    ModelFile() : fd(-1), addr(NULL), len(0)
+    {
+        memset(&stats_, 0, sizeof(stats_));
+    }
+
+    ~ModelFile() { release(); }
+
+    ModelFile(const ModelFile &) = delete;
+    ModelFile &operator=(const ModelFile &) = delete;
+
+    // 成功返回 0
+    int open(const char *path)
+    {
+        release();
+        auto t0 = std::chrono::steady_clock::now();
+        fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            printf("open %s failed: %s\n", path, strerror(errno));
+            return -1;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            printf("bad model file %s\n", path);
+            release();
+            return -1;
+        }
+        len = (size_t)st.st_size;
+        auto t1 = std::chrono::steady_clock::now();
+
+        void *p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            printf("mmap %s failed: %s\n", path, strerror(errno));
+            release();
+            return -1;
+        }
+        addr = p;
+        // rknn_init 从头到尾读一遍: 加大预读，读过的页可以尽早回收
+        madvise(addr, len, MADV_SEQUENTIAL);
+        auto t2 = std::chrono::steady_clock::now();
+
+        stats_.open_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        stats_.map_ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        return 0;
+    }
+
+    // rknn_init 之后调用，之后 data() 失效
+    void release()
+    {
+        if (addr)
+        {
+            munmap(addr, len);
+            addr = NULL;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    const void *data() const { return addr; }
+    size_t size() const { return len; }
+    const ModelFileStats &stats() const { return stats_; }
+
+    void print_stats() const
+    {
+        printf("model: %zu bytes, open %.3f ms, mmap %.3f ms\n",
+               len, stats_.open_ms, stats_.map_ms);
+    }
+
+private:
+    int fd;
+    void *addr;
+    size_t len;
+    ModelFileStats stats_;
+};
+
+// 进程到目前为止的峰值 RSS（KB）
+static inline long peak_rss_kb()
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return -1;
+    return ru.ru_maxrss;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*******************************************************
+ * motion_gate.h
+ * 运动门控: 固定机位、画面静止时跳过 rknn_run + 后处理，沿用上一次的检测结果。
+ *
+ * 预处理时多做一个小 RGA 任务，把源帧缩成 MOTION_THUMB_W x MOTION_THUMB_H 的亮度图
+ * （源帧超过缩略图 RGA_MAX_SCALE 倍时先缩到 MOTION_MID_W x MOTION_MID_H 中间图，分两步），
+ * 和该路上一次真正推理时的参考图按 8x8 分块求 SAD（SIMD）；
+ * 任何一块的平均差超过门限才推理。参考图只在推理时更新，
+ * 缓慢变化会累积到超过门限；连续跳过 max_skip 帧也强制推理一次。
+ *******************************************************/
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "image_ops.h"
+#include "dma_pool.h"
+#include "int8_kernels.h"
+#include "trace.h"
+
+#define MOTION_THUMB_W 64 // 8 的倍数
+#define MOTION_THUMB_H 48
+// 两步缩放的中间图，缩略图的 4 倍: 到缩略图 4x，源帧最大支持 4096x3072
+#define MOTION_MID_W (MOTION_THUMB_W * 4)
+#define MOTION_MID_H (MOTION_THUMB_H * 4)
+#define MOTION_MAX_STREAMS 16 // 输入路数上限，超出的那几路不做门控
+
+struct MotionGateConfig
+{
+    float block_thresh; // 8x8 块内平均每像素绝对差（0~255）超过它算变化
+    int min_blocks;     // 至少这么多块变化才推理
+    int max_skip;       // 连续跳过这么多帧后强制推理，0 表示不限
+};
+
+static inline MotionGateConfig motion_gate_defaults()
+{
+    MotionGateConfig c;
+    c.block_thresh = 8.0f;
+    c.min_blocks = 1;
+    c.max_skip = 50;
+    return c;
+}
+
+struct MotionGateStats
+{
+    long frames;
+    long inferred; // 其中强制 / 首帧 / 尺寸变化的也算
+    long skipped;
+    long forced;   // 因 max_skip 强制推理的
+};
+
+class MotionGate
+{
+public:
+    MotionGate(ImageOps &ops, const MotionGateConfig &cfg)
+        : ops(ops), cfg(cfg)
+    {
+        memset(&stats_, 0, sizeof(stats_));
+        for (int i = 0; i < MOTION_MAX_STREAMS; i++)
+            streams[i].valid = false;
+    }
+
+    // 缩略图缓冲: RGA 写、CPU 读，走带 cache 的池子；中间图只有 RGA 读写；成功返回 0
+    int init()
+    {
+        thumb_buf = dma_pool_cached().acquire(MOTION_THUMB_W * MOTION_THUMB_H);
+        mid_buf = dma_pool().acquire(MOTION_MID_W * MOTION_MID_H);
+        if (!thumb_buf || !mid_buf)
+            return -1;
+        thumb = make_image_buffer(thumb_buf.fd(), thumb_buf.virt(), MOTION_THUMB_W,
+                                  MOTION_THUMB_H, PIXEL_GRAY8);
+        mid = make_image_buffer(mid_buf.fd(), mid_buf.virt(), MOTION_MID_W, MOTION_MID_H,
+                                PIXEL_GRAY8);
+        return 0;
+    }
+
+    /*
+     * source 为输入路的下标（IngestFrame::source，同一路的参考图才有可比性），
+     * frame 为这一帧的源图。返回 true 表示要推理；缩略图出错时也返回 true，宁可多跑。
+     * 跳过时调用方沿用这一路上一次的结果。
+     */
+    bool should_run(const ImageBuffer &frame, int source)
+    {
+        TRACE_SPAN("motion_gate");
+        stats_.frames++;
+        if (source < 0 || source >= MOTION_MAX_STREAMS)
+        {
+            stats_.inferred++;
+            return true;
+        }
+        Stream &s = streams[source];
+
+        if (make_thumb(frame) != 0)
+        {
+            s.valid = false;
+            stats_.inferred++;
+            return true;
+        }
+
+        bool run;
+        if (!s.valid || s.frame_w != frame.width || s.frame_h != frame.height)
+            run = true;
+        else if (cfg.max_skip > 0 && s.skipped >= cfg.max_skip)
+        {
+            run = true;
+            stats_.forced++;
+        }
+        else
+            run = changed(s);
+
+        if (!run)
+        {
+            s.skipped++;
+            stats_.skipped++;
+            return false;
+        }
+
+        // 推理的这一帧成为新参考
+        {
+            DmaCpuAccess cpu(thumb_buf, DMA_BUF_SYNC_READ);
+            memcpy(s.ref, thumb_buf.virt(), sizeof(s.ref));
+        }
+        s.valid = true;
+        s.frame_w = frame.width;
+        s.frame_h = frame.height;
+        s.skipped = 0;
+        stats_.inferred++;
+        return true;
+    }
+
+    const MotionGateStats &stats() const { return stats_; }
+
+    // infer_ms: 一次推理（预处理 + rknn_run + 后处理）的平均耗时，用来估算省下的时间
+    void print_stats(double infer_ms) const
+    {
+        long n = stats_.frames ? stats_.frames : 1;
+        printf("motion gate: %ld frames, %ld inferred (%ld forced), %ld skipped (%.1f%%), "
+               "~%.1f ms NPU + post saved\n",
+               stats_.frames, stats_.inferred, stats_.forced, stats_.skipped,
+               100.0 * stats_.skipped / n, stats_.skipped * infer_ms);
+    }
+
+private:
+    static const int BLOCKS = (MOTION_THUMB_W / 8) * (MOTION_THUMB_H / 8);
+
+    struct Stream
+    {
+        bool valid;
+        int frame_w, frame_h;
+        int skipped; // 连续跳过的帧数
+        uint8_t ref[MOTION_THUMB_W * MOTION_THUMB_H];
+    };
+
+    // 源帧缩成缩略图；每一步都不超过 RGA 的缩放上限，成功返回 0
+    int make_thumb(const ImageBuffer &frame)
+    {
+        const ImageRect full = make_rect(0, 0, frame.width, frame.height);
+        const ImageRect thumb_rect = make_rect(0, 0, MOTION_THUMB_W, MOTION_THUMB_H);
+        if (frame.width <= MOTION_THUMB_W * RGA_MAX_SCALE &&
+            frame.height <= MOTION_THUMB_H * RGA_MAX_SCALE)
+            return ops.resize(frame, full, thumb, thumb_rect);
+
+        // 720p / 1080p 直接缩到 64x48 超过 1/16，经中间图分两步
+        if (frame.width > MOTION_MID_W * RGA_MAX_SCALE ||
+            frame.height > MOTION_MID_H * RGA_MAX_SCALE)
+            return -1;
+        const ImageRect mid_rect = make_rect(0, 0, MOTION_MID_W, MOTION_MID_H);
+        if (ops.resize(frame, full, mid, mid_rect) != 0)
+            return -1;
+        return ops.resize(mid, mid_rect, thumb, thumb_rect);
+    }
+
+    bool changed(const Stream &s)
+    {
+        uint32_t sums[BLOCKS];
+        {
+            DmaCpuAccess cpu(thumb_buf, DMA_BUF_SYNC_READ);
+            sad_8x8_u8((const uint8_t *)thumb_buf.virt(), s.ref, MOTION_THUMB_W, MOTION_THUMB_H,
+                       sums);
+        }
+        const uint32_t th = (uint32_t)(cfg.block_thresh * 64);
+        int n = 0;
+        for (int i = 0; i < BLOCKS; i++)
+            n += sums[i] > th;
+        return n >= cfg.min_blocks;
+    }
+
+    ImageOps &ops;
+    const MotionGateConfig cfg;
+    DmaBuffer thumb_buf;
+    ImageBuffer thumb;
+    DmaBuffer mid_buf;
+    ImageBuffer mid;
+    Stream streams[MOTION_MAX_STREAMS]; // 按 source 下标
+    MotionGateStats stats_;
+};
+
+#endif
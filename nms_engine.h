@@ -0,0 +1,207 @@
+/*******************************************************
+ * nms_engine.h
+ * 按类分桶的贪心 NMS: SoA 坐标 + 4 lane SIMD IoU + max_det 提前结束
+ *******************************************************/
+#ifndef NMS_ENGINE_H
+#define NMS_ENGINE_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NMS_ENGINE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NMS_ENGINE_SSE2 1
+#endif
+
+#define NMS_BLOCK 4
+
+/*
+ * 和 "按分数排序 + 全对比较" 的贪心 NMS 结果一致:
+ * 候选 j 被保留当且仅当它和同类所有更高分的已保留框 IoU <= iou_thresh。
+ * 因此按全局分数顺序走一遍，只和本类已保留框比较即可；
+ * 每类的已保留框存成 4 个一组的 SoA 块链，一次算 4 个 IoU。
+ * 保留数到 max_det (> 0) 即停止，结果是完整 NMS 输出的前 max_det 个。
+ * 所有缓冲区跨帧复用，稳态不再分配。
+ */
+class NmsEngine
+{
+public:
+    explicit NmsEngine(float iou_thresh = 0.45f, int max_det = 0)
+        : iou_thresh(iou_thresh), max_det(max_det), nblocks(0)
+    {
+    }
+
+    void set_max_det(int n) { max_det = n; }
+    int get_max_det() const { return max_det; }
+
+    // 预分配 n 个候选、num_classes 个类别的缓冲
+    void reserve(int n, int num_classes)
+    {
+        order.reserve(n);
+        blocks.reserve(n);
+        if ((int)cls_head.size() < num_classes)
+        {
+            cls_head.resize(num_classes, -1);
+            cls_tail.resize(num_classes, -1);
+        }
+    }
+
+    // 输入 n 个候选的坐标/分数/类别列，keep 输出保留下标（分数降序），返回个数
+    int run(const float *x1, const float *y1, const float *x2, const float *y2,
+            const float *score, const int *cls, int n, int *keep)
+    {
+        order.resize(n);
+        for (int i = 0; i < n; i++)
+            order[i] = i;
+        // 同分按下标排，保证结果确定
+        std::sort(order.begin(), order.end(),
+                  [score](int a, int b)
+                  { return score[a] > score[b] || (score[a] == score[b] && a < b); });
+
+        nblocks = 0;
+        for (size_t c = 0; c < cls_head.size(); c++)
+            cls_head[c] = -1;
+
+        int limit = max_det > 0 ? max_det : n;
+        int nkeep = 0;
+        for (int k = 0; k < n && nkeep < limit; k++)
+        {
+            int i = order[k];
+            int c = cls[i];
+            if (c >= (int)cls_head.size())
+            {
+                cls_head.resize(c + 1, -1);
+                cls_tail.resize(c + 1, -1);
+            }
+
+            float area = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+            if (suppressed(c, x1[i], y1[i], x2[i], y2[i], area))
+                continue;
+
+            append(c, x1[i], y1[i], x2[i], y2[i], area);
+            keep[nkeep++] = i;
+        }
+        return nkeep;
+    }
+
+private:
+    // 一块最多 NMS_BLOCK 个同类已保留框
+    struct KeptBlock
+    {
+        float x1[NMS_BLOCK], y1[NMS_BLOCK], x2[NMS_BLOCK], y2[NMS_BLOCK], area[NMS_BLOCK];
+        int count;
+        int next;
+    };
+
+    void append(int c, float bx1, float by1, float bx2, float by2, float area)
+    {
+        int t = cls_tail[c];
+        if (cls_head[c] < 0 || blocks[t].count == NMS_BLOCK)
+        {
+            if (nblocks == (int)blocks.size())
+                blocks.resize(nblocks + 1);
+            KeptBlock &nb = blocks[nblocks];
+            for (int l = 0; l < NMS_BLOCK; l++)
+                nb.x1[l] = nb.y1[l] = nb.x2[l] = nb.y2[l] = nb.area[l] = 0.f;
+            nb.count = 0;
+            nb.next = -1;
+            if (cls_head[c] < 0)
+                cls_head[c] = nblocks;
+            else
+                blocks[t].next = nblocks;
+            cls_tail[c] = t = nblocks++;
+        }
+        KeptBlock &blk = blocks[t];
+        int l = blk.count++;
+        blk.x1[l] = bx1;
+        blk.y1[l] = by1;
+        blk.x2[l] = bx2;
+        blk.y2[l] = by2;
+        blk.area[l] = area;
+    }
+
+    // 候选 b 是否被类 c 的某个已保留框抑制
+    // IoU 计算顺序与标量 iou(kept, cand) 相同: inter / ((areaA + areaB) - inter)
+    bool suppressed(int c, float bx1, float by1, float bx2, float by2, float barea) const
+    {
+        for (int t = cls_head[c]; t >= 0; t = blocks[t].next)
+        {
+            const KeptBlock &blk = blocks[t];
+            const int valid = (1 << blk.count) - 1;
+#if defined(NMS_ENGINE_SSE2)
+            const __m128 zero = _mm_setzero_ps();
+            __m128 xx1 = _mm_max_ps(_mm_loadu_ps(blk.x1), _mm_set1_ps(bx1));
+            __m128 yy1 = _mm_max_ps(_mm_loadu_ps(blk.y1), _mm_set1_ps(by1));
+            __m128 xx2 = _mm_min_ps(_mm_loadu_ps(blk.x2), _mm_set1_ps(bx2));
+            __m128 yy2 = _mm_min_ps(_mm_loadu_ps(blk.y2), _mm_set1_ps(by2));
+            __m128 w = _mm_max_ps(zero, _mm_sub_ps(xx2, xx1));
+            __m128 h = _mm_max_ps(zero, _mm_sub_ps(yy2, yy1));
+            __m128 inter = _mm_mul_ps(w, h);
+            __m128 uni = _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(blk.area), _mm_set1_ps(barea)), inter);
+            __m128 hit = _mm_cmpgt_ps(_mm_div_ps(inter, uni), _mm_set1_ps(iou_thresh));
+            if (_mm_movemask_ps(hit) & valid)
+                return true;
+#elif defined(NMS_ENGINE_NEON)
+            const float32x4_t zero = vdupq_n_f32(0.f);
+            float32x4_t xx1 = vmaxq_f32(vld1q_f32(blk.x1), vdupq_n_f32(bx1));
+            float32x4_t yy1 = vmaxq_f32(vld1q_f32(blk.y1), vdupq_n_f32(by1));
+            float32x4_t xx2 = vminq_f32(vld1q_f32(blk.x2), vdupq_n_f32(bx2));
+            float32x4_t yy2 = vminq_f32(vld1q_f32(blk.y2), vdupq_n_f32(by2));
+            float32x4_t w = vmaxq_f32(zero, vsubq_f32(xx2, xx1));
+            float32x4_t h = vmaxq_f32(zero, vsubq_f32(yy2, yy1));
+            float32x4_t inter = vmulq_f32(w, h);
+            // 绝大多数块完全不相交，先整体判断 inter 是否全 0
+            uint32x4_t nz = vcgtq_f32(inter, zero);
+            uint32x2_t nz2 = vorr_u32(vget_low_u32(nz), vget_high_u32(nz));
+            if (!(vget_lane_u32(nz2, 0) | vget_lane_u32(nz2, 1)))
+                continue;
+            float32x4_t uni = vsubq_f32(vaddq_f32(vld1q_f32(blk.area), vdupq_n_f32(barea)), inter);
+#if defined(__aarch64__)
+            uint32x4_t hit = vcgtq_f32(vdivq_f32(inter, uni), vdupq_n_f32(iou_thresh));
+            uint32_t lanes[4];
+            vst1q_u32(lanes, hit);
+            for (int l = 0; l < blk.count; l++)
+                if (lanes[l])
+                    return true;
+#else
+            // ARMv7 NEON 没有除法，只对相交的 lane 做标量除法，结果与标量路径逐位一致
+            float fi[4], fu[4];
+            vst1q_f32(fi, inter);
+            vst1q_f32(fu, uni);
+            for (int l = 0; l < blk.count; l++)
+                if (fi[l] > 0.f && fi[l] / fu[l] > iou_thresh)
+                    return true;
+#endif
+#else
+            for (int l = 0; l < blk.count; l++)
+            {
+                float xx1 = std::max(blk.x1[l], bx1);
+                float yy1 = std::max(blk.y1[l], by1);
+                float xx2 = std::min(blk.x2[l], bx2);
+                float yy2 = std::min(blk.y2[l], by2);
+                float w = std::max(0.f, xx2 - xx1);
+                float h = std::max(0.f, yy2 - yy1);
+                float inter = w * h;
+                if (inter / (blk.area[l] + barea - inter) > iou_thresh)
+                    return true;
+            }
+#endif
+            (void)valid;
+        }
+        return false;
+    }
+
+    float iou_thresh;
+    int max_det;
+
+    std::vector<int> order;        // 全局分数降序的候选下标
+    std::vector<KeptBlock> blocks; // 已保留框块池，按类串成链
+    int nblocks;
+    std::vector<int> cls_head, cls_tail;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*******************************************************
+ * npu_backend.h
+ * demo 用到的那几个 rknn 调用的抽象层：真机直接转给 librknnmrt，
+ * 录制 / 回放实现见 npu_replay.h
+ *******************************************************/
+#ifndef NPU_BACKEND_H
+#define NPU_BACKEND_H
+
+#include <rknn_api.h>
+
+// 返回值沿用 rknn 的约定: RKNN_SUCC 为成功
+class NpuBackend
+{
+public:
+    virtual ~NpuBackend() {}
+
+    virtual int init(rknn_context *ctx, void *model, uint32_t size, uint32_t flags) = 0;
+    virtual int destroy(rknn_context ctx) = 0;
+    virtual int query(rknn_context ctx, rknn_query_cmd cmd, void *info, uint32_t size) = 0;
+    virtual rknn_tensor_mem *create_mem(rknn_context ctx, uint32_t size) = 0;
+    virtual int destroy_mem(rknn_context ctx, rknn_tensor_mem *mem) = 0;
+    virtual int set_io_mem(rknn_context ctx, rknn_tensor_mem *mem, rknn_tensor_attr *attr) = 0;
+    virtual int run(rknn_context ctx) = 0;
+};
+
+/*
+ * 主机上没有 librknnmrt 时定义 NPU_BACKEND_NO_RKNN，
+ * 只留接口（rknn_api.h 只用到类型），必须显式给回放后端
+ */
+#ifndef NPU_BACKEND_NO_RKNN
+class RknnBackend : public NpuBackend
+{
+public:
+    int init(rknn_context *ctx, void *model, uint32_t size, uint32_t flags) override
+    {
+        return rknn_init(ctx, model, size, flags, NULL);
+    }
+
+    int destroy(rknn_context ctx) override
+    {
+        return rknn_destroy(ctx);
+    }
+
+    int query(rknn_context ctx, rknn_query_cmd cmd, void *info, uint32_t size) override
+    {
+        return rknn_query(ctx, cmd, info, size);
+    }
+
+    rknn_tensor_mem *create_mem(rknn_context ctx, uint32_t size) override
+    {
+        return rknn_create_mem(ctx, size);
+    }
+
+    int destroy_mem(rknn_context ctx, rknn_tensor_mem *mem) override
+    {
+        return rknn_destroy_mem(ctx, mem);
+    }
+
+    int set_io_mem(rknn_context ctx, rknn_tensor_mem *mem, rknn_tensor_attr *attr) override
+    {
+        return rknn_set_io_mem(ctx, mem, attr);
+    }
+
+    int run(rknn_context ctx) override
+    {
+        return rknn_run(ctx, NULL);
+    }
+};
+#endif
+
+// Infer 不指定后端时用的默认后端；NPU_BACKEND_NO_RKNN 下初始为 NULL
+inline NpuBackend *&npu_default_backend_ref()
+{
+#ifndef NPU_BACKEND_NO_RKNN
+    static RknnBackend rknn;
+    static NpuBackend *backend = &rknn;
+#else
+    static NpuBackend *backend = NULL;
+#endif
+    return backend;
+}
+
+inline NpuBackend *npu_default_backend()
+{
+    return npu_default_backend_ref();
+}
+
+// 换掉默认后端（主机上装回放后端，走和真机 demo 一样的构造路径）；在建 Infer 之前调用
+inline void npu_set_default_backend(NpuBackend *backend)
+{
+    npu_default_backend_ref() = backend;
+}
+
+#endif
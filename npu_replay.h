@@ -0,0 +1,439 @@
+/*******************************************************
+ * npu_replay.h
+ * 录制 / 回放 NPU 后端:
+ *   NpuRecordBackend 套在真机后端外面，把 rknn_query 结果和每次 run 的
+ *   输入/输出张量写进目录；
+ *   NpuReplayBackend 在主机上读这个目录，query 返回录下的属性，
+ *   run 把录下的输出拷进绑定的 mem，后处理可以离线计时、对比金标准
+ *
+ * 目录格式:
+ *   queries.bin       "RKQ1" + N * {u32 cmd, u32 index, u32 size, bytes}
+ *   frame_%06d.bin    "RKF1" + u32 n + n * {u32 kind(0 入 / 1 出), u32 index, u32 size, bytes}
+ *******************************************************/
+#ifndef NPU_REPLAY_H
+#define NPU_REPLAY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "npu_backend.h"
+
+/* =================== 公共 =================== */
+enum
+{
+    NPU_TENSOR_INPUT = 0,
+    NPU_TENSOR_OUTPUT = 1,
+};
+
+// 带 rknn_tensor_attr 的查询按 attr.index 区分，其余 index 记 0
+static inline bool npu_query_is_attr(rknn_query_cmd cmd)
+{
+    return cmd == RKNN_QUERY_INPUT_ATTR || cmd == RKNN_QUERY_OUTPUT_ATTR ||
+           cmd == RKNN_QUERY_NATIVE_INPUT_ATTR || cmd == RKNN_QUERY_NATIVE_OUTPUT_ATTR ||
+           cmd == RKNN_QUERY_NATIVE_NHWC_INPUT_ATTR || cmd == RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR;
+}
+
+static inline bool npu_query_is_output_attr(rknn_query_cmd cmd)
+{
+    return cmd == RKNN_QUERY_OUTPUT_ATTR || cmd == RKNN_QUERY_NATIVE_OUTPUT_ATTR ||
+           cmd == RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR;
+}
+
+static inline std::string npu_frame_path(const std::string &dir, long frame)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/frame_%06ld.bin", frame);
+    return dir + name;
+}
+
+/*
+ * rknn_set_io_mem 本身不区分输入输出，这里按 index + 张量名对照查询过的属性；
+ * 对不上的按输出算
+ */
+class NpuIoBinding
+{
+public:
+    void note_query(rknn_query_cmd cmd, const void *info)
+    {
+        if (!npu_query_is_attr(cmd))
+            return;
+        const rknn_tensor_attr *a = (const rknn_tensor_attr *)info;
+        std::vector<std::string> &names = npu_query_is_output_attr(cmd) ? out_names : in_names;
+        if (names.size() <= a->index)
+            names.resize(a->index + 1);
+        names[a->index] = a->name;
+    }
+
+    // 记下绑定，返回 NPU_TENSOR_INPUT / OUTPUT
+    int bind(rknn_tensor_mem *mem, const rknn_tensor_attr *attr)
+    {
+        int kind = NPU_TENSOR_OUTPUT;
+        if (!(attr->index < out_names.size() && out_names[attr->index] == attr->name) &&
+            attr->index < in_names.size() && in_names[attr->index] == attr->name)
+            kind = NPU_TENSOR_INPUT;
+
+        std::vector<Bound> &list = bound[kind];
+        if (list.size() <= attr->index)
+            list.resize(attr->index + 1);
+        list[attr->index].mem = mem;
+        list[attr->index].size = attr->size_with_stride ? attr->size_with_stride : mem->size;
+        return kind;
+    }
+
+    struct Bound
+    {
+        Bound() : mem(NULL), size(0) {}
+        rknn_tensor_mem *mem;
+        uint32_t size;
+    };
+
+    std::vector<Bound> bound[2];
+
+private:
+    std::vector<std::string> in_names, out_names;
+};
+
+/* =================== 录制 =================== */
+class NpuRecordBackend : public NpuBackend
+{
+public:
+    NpuRecordBackend(NpuBackend &inner, const char *dir)
+        : inner(inner), dir(dir), frames(0)
+    {
+        std::string path = this->dir + "/queries.bin";
+        fq = fopen(path.c_str(), "wb");
+        if (!fq)
+            printf("record: open %s failed\n", path.c_str());
+        else
+            fwrite("RKQ1", 1, 4, fq);
+    }
+
+    ~NpuRecordBackend()
+    {
+        if (fq)
+            fclose(fq);
+    }
+
+    int init(rknn_context *ctx, void *model, uint32_t size, uint32_t flags) override
+    {
+        return inner.init(ctx, model, size, flags);
+    }
+
+    int destroy(rknn_context ctx) override
+    {
+        return inner.destroy(ctx);
+    }
+
+    int query(rknn_context ctx, rknn_query_cmd cmd, void *info, uint32_t size) override
+    {
+        int ret = inner.query(ctx, cmd, info, size);
+        if (ret == RKNN_SUCC && fq)
+        {
+            uint32_t hdr[3] = {(uint32_t)cmd,
+                               npu_query_is_attr(cmd) ? ((rknn_tensor_attr *)info)->index : 0u,
+                               size};
+            fwrite(hdr, sizeof(hdr), 1, fq);
+            fwrite(info, 1, size, fq);
+            fflush(fq);
+            io.note_query(cmd, info);
+        }
+        return ret;
+    }
+
+    rknn_tensor_mem *create_mem(rknn_context ctx, uint32_t size) override
+    {
+        return inner.create_mem(ctx, size);
+    }
+
+    int destroy_mem(rknn_context ctx, rknn_tensor_mem *mem) override
+    {
+        return inner.destroy_mem(ctx, mem);
+    }
+
+    int set_io_mem(rknn_context ctx, rknn_tensor_mem *mem, rknn_tensor_attr *attr) override
+    {
+        int ret = inner.set_io_mem(ctx, mem, attr);
+        if (ret == RKNN_SUCC)
+            io.bind(mem, attr);
+        return ret;
+    }
+
+    // run 成功后把当前绑定的输入和输出整块写成一帧
+    int run(rknn_context ctx) override
+    {
+        int ret = inner.run(ctx);
+        if (ret == RKNN_SUCC)
+            write_frame();
+        return ret;
+    }
+
+    long recorded() const { return frames; }
+
+private:
+    void write_frame()
+    {
+        std::string path = npu_frame_path(dir, frames);
+        FILE *fp = fopen(path.c_str(), "wb");
+        if (!fp)
+        {
+            printf("record: open %s failed\n", path.c_str());
+            return;
+        }
+        uint32_t n = 0;
+        for (int k = 0; k < 2; k++)
+            for (size_t i = 0; i < io.bound[k].size(); i++)
+                n += io.bound[k][i].mem != NULL;
+        fwrite("RKF1", 1, 4, fp);
+        fwrite(&n, sizeof(n), 1, fp);
+        for (int k = 0; k < 2; k++)
+        {
+            for (size_t i = 0; i < io.bound[k].size(); i++)
+            {
+                const NpuIoBinding::Bound &b = io.bound[k][i];
+                if (!b.mem)
+                    continue;
+                uint32_t hdr[3] = {(uint32_t)k, (uint32_t)i, b.size};
+                fwrite(hdr, sizeof(hdr), 1, fp);
+                fwrite(b.mem->virt_addr, 1, b.size, fp);
+            }
+        }
+        fclose(fp);
+        frames++;
+    }
+
+    NpuBackend &inner;
+    std::string dir;
+    FILE *fq;
+    NpuIoBinding io;
+    long frames;
+};
+
+/* =================== 回放 =================== */
+struct NpuReplayStats
+{
+    long runs;           // run 次数（超过录制帧数后循环）
+    long input_checked;  // 和录下的输入比过的帧数
+    double input_mad;    // 最近一帧输入与录制输入的平均绝对差
+};
+
+class NpuReplayBackend : public NpuBackend
+{
+public:
+    explicit NpuReplayBackend(const char *dir) : dir(dir), frames(0)
+    {
+        memset(&stats_, 0, sizeof(stats_));
+    }
+
+    ~NpuReplayBackend()
+    {
+        for (size_t i = 0; i < mems.size(); i++)
+            release_mem(mems[i]);
+    }
+
+    // 载入 queries.bin 并数帧；录制目录不完整返回错误
+    int init(rknn_context *ctx, void *model, uint32_t size, uint32_t flags) override
+    {
+        (void)model;
+        (void)size;
+        (void)flags;
+        if (load_queries() != 0)
+            return RKNN_ERR_FAIL;
+        frames = 0;
+        for (;;)
+        {
+            FILE *fp = fopen(npu_frame_path(dir, frames).c_str(), "rb");
+            if (!fp)
+                break;
+            fclose(fp);
+            frames++;
+        }
+        if (frames == 0)
+        {
+            printf("replay: no frames in %s\n", dir.c_str());
+            return RKNN_ERR_FAIL;
+        }
+        *ctx = 1;
+        return RKNN_SUCC;
+    }
+
+    int destroy(rknn_context ctx) override
+    {
+        (void)ctx;
+        return RKNN_SUCC;
+    }
+
+    int query(rknn_context ctx, rknn_query_cmd cmd, void *info, uint32_t size) override
+    {
+        (void)ctx;
+        uint32_t index = npu_query_is_attr(cmd) ? ((rknn_tensor_attr *)info)->index : 0u;
+        // 同一查询录了多次时以最后一次为准
+        for (size_t i = queries.size(); i-- > 0;)
+        {
+            const Query &q = queries[i];
+            if (q.cmd != (uint32_t)cmd || q.index != index)
+                continue;
+            memcpy(info, q.data.data(), q.data.size() < size ? q.data.size() : size);
+            io.note_query(cmd, info);
+            return RKNN_SUCC;
+        }
+        return RKNN_ERR_PARAM_INVALID;
+    }
+
+    rknn_tensor_mem *create_mem(rknn_context ctx, uint32_t size) override
+    {
+        (void)ctx;
+        rknn_tensor_mem *mem = (rknn_tensor_mem *)calloc(1, sizeof(rknn_tensor_mem));
+        if (!mem)
+            return NULL;
+        mem->virt_addr = calloc(1, size);
+        mem->fd = -1;
+        mem->size = size;
+        if (!mem->virt_addr)
+        {
+            free(mem);
+            return NULL;
+        }
+        mems.push_back(mem);
+        return mem;
+    }
+
+    int destroy_mem(rknn_context ctx, rknn_tensor_mem *mem) override
+    {
+        (void)ctx;
+        for (size_t i = 0; i < mems.size(); i++)
+        {
+            if (mems[i] == mem)
+            {
+                release_mem(mem);
+                mems.erase(mems.begin() + i);
+                return RKNN_SUCC;
+            }
+        }
+        return RKNN_ERR_PARAM_INVALID;
+    }
+
+    int set_io_mem(rknn_context ctx, rknn_tensor_mem *mem, rknn_tensor_attr *attr) override
+    {
+        (void)ctx;
+        io.bind(mem, attr);
+        return RKNN_SUCC;
+    }
+
+    // 下一帧录制的输出拷进绑定的输出 mem；绑定的输入和录下的输入对比
+    int run(rknn_context ctx) override
+    {
+        (void)ctx;
+        std::string path = npu_frame_path(dir, stats_.runs % frames);
+        FILE *fp = fopen(path.c_str(), "rb");
+        if (!fp)
+            return RKNN_ERR_FAIL;
+
+        char magic[4];
+        uint32_t n = 0;
+        int ret = RKNN_SUCC;
+        if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, "RKF1", 4) != 0 ||
+            fread(&n, sizeof(n), 1, fp) != 1)
+            ret = RKNN_ERR_FAIL;
+
+        for (uint32_t t = 0; ret == RKNN_SUCC && t < n; t++)
+        {
+            uint32_t hdr[3];
+            if (fread(hdr, sizeof(hdr), 1, fp) != 1 || hdr[0] > NPU_TENSOR_OUTPUT)
+            {
+                ret = RKNN_ERR_FAIL;
+                break;
+            }
+            scratch.resize(hdr[2]);
+            if (fread(scratch.data(), 1, hdr[2], fp) != hdr[2])
+            {
+                ret = RKNN_ERR_FAIL;
+                break;
+            }
+            const std::vector<NpuIoBinding::Bound> &list = io.bound[hdr[0]];
+            if (hdr[1] >= list.size() || !list[hdr[1]].mem)
+                continue;
+            rknn_tensor_mem *mem = list[hdr[1]].mem;
+            uint32_t len = hdr[2] < mem->size ? hdr[2] : mem->size;
+            if (hdr[0] == NPU_TENSOR_OUTPUT)
+                memcpy(mem->virt_addr, scratch.data(), len);
+            else
+                compare_input((const uint8_t *)mem->virt_addr, len);
+        }
+        fclose(fp);
+        if (ret != RKNN_SUCC)
+            printf("replay: bad frame file %s\n", path.c_str());
+        stats_.runs++;
+        return ret;
+    }
+
+    long recorded_frames() const { return frames; }
+    const NpuReplayStats &stats() const { return stats_; }
+
+private:
+    struct Query
+    {
+        uint32_t cmd, index;
+        std::vector<uint8_t> data;
+    };
+
+    int load_queries()
+    {
+        std::string path = dir + "/queries.bin";
+        FILE *fp = fopen(path.c_str(), "rb");
+        if (!fp)
+        {
+            printf("replay: open %s failed\n", path.c_str());
+            return -1;
+        }
+        char magic[4];
+        int ret = (fread(magic, 1, 4, fp) == 4 && memcmp(magic, "RKQ1", 4) == 0) ? 0 : -1;
+        queries.clear();
+        while (ret == 0)
+        {
+            uint32_t hdr[3];
+            if (fread(hdr, sizeof(hdr), 1, fp) != 1)
+                break;
+            Query q;
+            q.cmd = hdr[0];
+            q.index = hdr[1];
+            q.data.resize(hdr[2]);
+            if (fread(q.data.data(), 1, hdr[2], fp) != hdr[2])
+                ret = -1;
+            else
+                queries.push_back(q);
+        }
+        fclose(fp);
+        if (ret != 0)
+            printf("replay: bad %s\n", path.c_str());
+        return ret;
+    }
+
+    void compare_input(const uint8_t *cur, uint32_t len)
+    {
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < len; i++)
+            sum += abs((int)cur[i] - (int)scratch[i]);
+        stats_.input_mad = len ? (double)sum / len : 0;
+        stats_.input_checked++;
+    }
+
+    static void release_mem(rknn_tensor_mem *mem)
+    {
+        free(mem->virt_addr);
+        free(mem);
+    }
+
+    std::string dir;
+    long frames;
+    std::vector<Query> queries;
+    std::vector<rknn_tensor_mem *> mems;
+    std::vector<uint8_t> scratch;
+    NpuIoBinding io;
+    NpuReplayStats stats_;
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*******************************************************
+ * pipeline.h
+ * 三段流水: 准备(读图/解码/letterbox) -> NPU -> 后处理，
+ * 各占一个线程，段间用 SPSC 队列传 slot；N 个 slot 轮转，
+ * 第 N+1 帧在准备时第 N 帧在 NPU 上跑、第 N-1 帧在做后处理
+ *******************************************************/
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+#include "spsc_queue.h"
+#include "trace.h"
+
+/*
+ * slot 是一整套帧缓冲（输入张量 + 输出张量 + 帧相关状态）的编号，
+ * 由实现方按 Pipeline 的 slot 数预先建好。同一 slot 同一时刻只在一个阶段里。
+ */
+class PipelineStages
+{
+public:
+    virtual ~PipelineStages() {}
+
+    // 调用线程: 把第 frame 帧准备进 slot；没有更多输入时返回 false
+    virtual bool prepare(int slot, long frame) = 0;
+
+    // NPU 线程: 跑 slot，返回 0 成功
+    virtual int run(int slot) = 0;
+
+    // 后处理线程: 消费 slot 的输出，status 为 run() 的返回值
+    virtual void finish(int slot, long frame, int status) = 0;
+};
+
+struct PipelineStats
+{
+    long frames;
+    double wall_ms;
+    double fps;
+};
+
+class Pipeline
+{
+public:
+    // slots = 1 时三段自然串行，可以当作不流水的对照
+    Pipeline(PipelineStages &stages, int slots)
+        : stages(stages), slots(slots < 1 ? 1 : slots),
+          free_q(this->slots + 1), run_q(this->slots + 1), post_q(this->slots + 1)
+    {
+    }
+
+    // 跑到 prepare 返回 false 且所有帧都 finish 为止
+    PipelineStats run()
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < slots; i++)
+            free_q.push(i);
+
+        std::thread npu(&Pipeline::npu_loop, this);
+        std::thread post(&Pipeline::post_loop, this);
+
+        TRACE_THREAD_NAME("prepare");
+        long frame = 0;
+        for (;;)
+        {
+            Token tok;
+            {
+                // 等后处理还回 slot 的时间，长说明后面两段是瓶颈
+                TRACE_SPAN("wait_slot");
+                free_q.pop(tok.slot);
+            }
+            if (!stages.prepare(tok.slot, frame))
+                break;
+            tok.frame = frame++;
+            tok.status = 0;
+            run_q.push(tok);
+        }
+
+        // 结束标记顺着队列流下去，保证前面的帧都处理完
+        Token end;
+        end.slot = -1;
+        end.frame = frame;
+        end.status = 0;
+        run_q.push(end);
+        npu.join();
+        post.join();
+
+        PipelineStats st;
+        st.frames = frame;
+        st.wall_ms = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - t0)
+                         .count();
+        st.fps = st.wall_ms > 0 ? frame * 1000.0 / st.wall_ms : 0;
+        return st;
+    }
+
+private:
+    struct Token
+    {
+        int slot;
+        long frame;
+        int status;
+    };
+
+    void npu_loop()
+    {
+        TRACE_THREAD_NAME("npu");
+        for (;;)
+        {
+            Token tok;
+            run_q.pop(tok);
+            if (tok.slot >= 0)
+                tok.status = stages.run(tok.slot);
+            post_q.push(tok);
+            if (tok.slot < 0)
+                return;
+        }
+    }
+
+    void post_loop()
+    {
+        TRACE_THREAD_NAME("post");
+        for (;;)
+        {
+            Token tok;
+            post_q.pop(tok);
+            if (tok.slot < 0)
+                return;
+            stages.finish(tok.slot, tok.frame, tok.status);
+            free_q.push(tok.slot);
+        }
+    }
+
+    PipelineStages &stages;
+    const int slots;
+    SpscQueue<int> free_q;   // 后处理 -> 准备: 空闲 slot
+    SpscQueue<Token> run_q;  // 准备 -> NPU
+    SpscQueue<Token> post_q; // NPU -> 后处理
+};
+
+#endif
@@ -0,0 +1,113 @@
+/*******************************************************
+ * pipeline_bench.cpp
+ * 主机上量流水线收益: 准备 / 后处理用忙等模拟 CPU 负载，
+ * NPU 用可配延时的 mock（睡眠，不占 CPU），slots=1 即串行对照
+ *******************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <chrono>
+#include <vector>
+
+#include "pipeline.h"
+
+static void busy_wait_ms(double ms)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0)
+               .count() < ms)
+    {
+    }
+}
+
+// mock NPU: run() 睡 npu_ms 模拟 rknn_run 阻塞在驱动里；每个 slot 记帧号用来校验
+class MockNpuStages : public PipelineStages
+{
+public:
+    MockNpuStages(int slots, long frames, double prepare_ms, double npu_ms, double post_ms)
+        : slot_frame(slots, -1), frames(frames), prepare_ms(prepare_ms), npu_ms(npu_ms),
+          post_ms(post_ms), next_finish(0), errors(0)
+    {
+    }
+
+    bool prepare(int slot, long frame) override
+    {
+        if (frame >= frames)
+            return false;
+        busy_wait_ms(prepare_ms);
+        slot_frame[slot] = frame;
+        return true;
+    }
+
+    int run(int slot) override
+    {
+        (void)slot;
+        struct timespec ts;
+        ts.tv_sec = (time_t)(npu_ms / 1000);
+        ts.tv_nsec = (long)((npu_ms - ts.tv_sec * 1000.0) * 1e6);
+        nanosleep(&ts, NULL);
+        return 0;
+    }
+
+    void finish(int slot, long frame, int status) override
+    {
+        // 帧必须按顺序、带着自己的 slot 到达
+        if (status != 0 || frame != next_finish || slot_frame[slot] != frame)
+            errors++;
+        next_finish++;
+        busy_wait_ms(post_ms);
+    }
+
+    long finished() const { return next_finish; }
+    long error_count() const { return errors; }
+
+private:
+    std::vector<long> slot_frame;
+    long frames;
+    double prepare_ms, npu_ms, post_ms;
+    long next_finish;
+    long errors;
+};
+
+int main(int argc, char **argv)
+{
+    long frames = argc > 1 ? atol(argv[1]) : 60;
+    double prepare_ms = argc > 2 ? atof(argv[2]) : 8.0;
+    double npu_ms = argc > 3 ? atof(argv[3]) : 10.0;
+    double post_ms = argc > 4 ? atof(argv[4]) : 3.0;
+    int max_slots = argc > 5 ? atoi(argv[5]) : 4;
+
+    if (frames <= 0 || prepare_ms < 0 || npu_ms < 0 || post_ms < 0 || max_slots < 1)
+    {
+        printf("Usage: %s [frames] [prepare_ms] [npu_ms] [post_ms] [max_slots]\n", argv[0]);
+        return -1;
+    }
+
+    printf("%ld frames, prepare %.1f ms, mock npu %.1f ms, post %.1f ms\n",
+           frames, prepare_ms, npu_ms, post_ms);
+    printf("%-6s %10s %10s %10s\n", "slots", "wall_ms", "fps", "speedup");
+
+    double base_fps = 0;
+    for (int slots = 1; slots <= max_slots; slots++)
+    {
+        MockNpuStages stages(slots, frames, prepare_ms, npu_ms, post_ms);
+        Pipeline pipeline(stages, slots);
+        PipelineStats st = pipeline.run();
+        if (stages.finished() != frames || stages.error_count() != 0)
+        {
+            printf("pipeline check failed: finished %ld / %ld, %ld errors\n",
+                   stages.finished(), frames, stages.error_count());
+            return -1;
+        }
+        if (slots == 1)
+            base_fps = st.fps;
+        printf("%-6d %10.1f %10.2f %9.2fx\n", slots, st.wall_ms, st.fps, st.fps / base_fps);
+    }
+
+    double ideal = prepare_ms > npu_ms ? prepare_ms : npu_ms;
+    ideal = ideal > post_ms ? ideal : post_ms;
+    if (ideal > 0)
+        printf("serial bound %.2f fps, pipelined bound %.2f fps\n",
+               1000.0 / (prepare_ms + npu_ms + post_ms), 1000.0 / ideal);
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*******************************************************
+ * preprocess.h
+ * 单趟 letterbox: 源图缩放直接写进模型输入张量的目标矩形，只填边带
+ *******************************************************/
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include <math.h>
+
+#include "image_ops.h"
+#include "letterbox.h"
+
+/* =================== letterbox 参数 =================== */
+struct LetterboxInfo
+{
+    float scale;
+    int resize_w, resize_h;
+    int pad_x, pad_y;
+};
+
+static inline LetterboxInfo letterbox_info(int src_w, int src_h, int dst_w, int dst_h)
+{
+    LetterboxInfo lb;
+    lb.scale = fmin((float)dst_w / src_w, (float)dst_h / src_h);
+    lb.resize_w = (int)(src_w * lb.scale);
+    lb.resize_h = (int)(src_h * lb.scale);
+    lb.pad_x = (dst_w - lb.resize_w) / 2;
+    lb.pad_y = (dst_h - lb.resize_h) / 2;
+    return lb;
+}
+
+/* =================== letterbox =================== */
+/*
+ * src 整幅缩放到 dst 的 (pad_x, pad_y, resize_w, resize_h)，
+ * 再把四条边带填成 fill；dst 通常就是绑定给 NPU 的输入张量内存，
+ * 中间不再经过 resize / letterbox 缓冲，也没有最后那次 memcpy。
+ */
+static inline int letterbox_into(ImageOps &ops, const ImageBuffer &src, const ImageBuffer &dst,
+                                 LetterboxInfo *info, uint8_t fill = LETTERBOX_FILL)
+{
+    LetterboxInfo lb = letterbox_info(src.width, src.height, dst.width, dst.height);
+    if (info)
+        *info = lb;
+
+    const int right = lb.pad_x + lb.resize_w;
+    const int bottom = lb.pad_y + lb.resize_h;
+    ImageRect bands[4] = {
+        make_rect(0, 0, dst.width, lb.pad_y), // 上
+        make_rect(0, bottom, dst.width, dst.height - bottom), // 下
+        make_rect(0, lb.pad_y, lb.pad_x, lb.resize_h), // 左
+        make_rect(right, lb.pad_y, dst.width - right, lb.resize_h), // 右
+    };
+    for (int i = 0; i < 4; i++)
+    {
+        if (bands[i].w > 0 && bands[i].h > 0 && ops.fill(dst, bands[i], fill) != 0)
+            return -1;
+    }
+
+    return ops.resize(src, make_rect(0, 0, src.width, src.height),
+                      dst, make_rect(lb.pad_x, lb.pad_y, lb.resize_w, lb.resize_h));
+}
+
+#endif
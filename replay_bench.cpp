@@ -0,0 +1,199 @@
+/*******************************************************
+ * replay_bench.cpp
+ * 主机上回放板子录下的 NPU 输出（rknn_yolov8s_infer_demo --record DIR），
+ * 对 YOLOv8 后处理计时，并和 DIR/golden.txt 逐框对比；
+ * 第一轮之后后处理还有堆分配时退出码非 0
+ *******************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <new>
+
+#include "npu_replay.h"
+#include "infer.h"
+#include "yolov8_detector.h"
+
+// 与 rknn_yolov8s_infer_demo.cpp 保持一致
+#define CONF_THRESH 0.25f
+#define NMS_THRESH 0.45f
+#define MAX_DET 300
+
+/* =================== 分配计数 =================== */
+// 统计 operator new 次数，检查后处理稳态零分配；单线程，不用原子。
+// 不内联，免得 GCC 把 malloc / free 对上 new / delete 报 mismatched 警告
+static size_t g_alloc_count = 0;
+
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    g_alloc_count++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+// 金标准一行一个框: frame cls score x1 y1 x2 y2
+struct GoldenBox
+{
+    long frame;
+    Box box;
+};
+
+static int load_golden(const std::string &path, std::vector<GoldenBox> &out)
+{
+    FILE *fp = fopen(path.c_str(), "r");
+    if (!fp)
+        return -1;
+    GoldenBox g;
+    while (fscanf(fp, "%ld %d %f %f %f %f %f", &g.frame, &g.box.cls, &g.box.score,
+                  &g.box.x1, &g.box.y1, &g.box.x2, &g.box.y2) == 7)
+        out.push_back(g);
+    fclose(fp);
+    return 0;
+}
+
+static bool same_box(const Box &a, const Box &b)
+{
+    const float eps = 1e-3f;
+    return a.cls == b.cls && fabsf(a.score - b.score) < eps &&
+           fabsf(a.x1 - b.x1) < eps && fabsf(a.y1 - b.y1) < eps &&
+           fabsf(a.x2 - b.x2) < eps && fabsf(a.y2 - b.y2) < eps;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s record_dir [iters] [--write-golden]\n", argv[0]);
+        return -1;
+    }
+    const std::string dir = argv[1];
+    int iters = 20;
+    bool write_golden = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--write-golden") == 0)
+            write_golden = true;
+        else
+            iters = atoi(argv[i]);
+    }
+    if (iters <= 0)
+        iters = 1;
+
+    NpuReplayBackend backend(dir.c_str());
+    std::unique_ptr<Infer> infer;
+    try
+    {
+        // 和真机 demo 一样不传 backend，走默认后端
+        npu_set_default_backend(&backend);
+        infer.reset(new Infer(dir.c_str(), 0));
+    }
+    catch (const std::exception &e)
+    {
+        printf("%s\n", e.what());
+        return -1;
+    }
+
+    SoftImageOps soft_ops;
+    YoloDetector detector(*infer, soft_ops, CONF_THRESH, NMS_THRESH, MAX_DET);
+    if (detector.init() != 0)
+        return -1;
+
+    const long frames = backend.recorded_frames();
+    std::vector<Box> boxes;
+    boxes.reserve(MAX_DET);
+    std::vector<GoldenBox> result;
+
+    // 第一轮收集结果，后面几轮只计时；run 只是把录制的输出拷进 mem
+    std::vector<double> post_ms;
+    post_ms.reserve(frames * iters);
+    size_t steady_allocs = 0; // 第一轮之后后处理里的堆分配次数，应为 0
+    for (int it = 0; it < iters; it++)
+    {
+        for (long f = 0; f < frames; f++)
+        {
+            if (detector.run() != 0)
+                return -1;
+            const size_t allocs_before = g_alloc_count;
+            auto t0 = std::chrono::steady_clock::now();
+            detector.postprocess(boxes);
+            auto t1 = std::chrono::steady_clock::now();
+            if (it > 0)
+                steady_allocs += g_alloc_count - allocs_before;
+            post_ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0)
+                                  .count());
+            if (it == 0)
+            {
+                for (size_t k = 0; k < boxes.size(); k++)
+                {
+                    GoldenBox g;
+                    g.frame = f;
+                    g.box = boxes[k];
+                    result.push_back(g);
+                }
+            }
+        }
+    }
+
+    std::sort(post_ms.begin(), post_ms.end());
+    double sum = 0;
+    for (size_t i = 0; i < post_ms.size(); i++)
+        sum += post_ms[i];
+    printf("replay %s: %ld frames x %d iters, %zu boxes\n", dir.c_str(), frames, iters, result.size());
+    printf("post_process avg %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           sum / post_ms.size(), post_ms[post_ms.size() / 2],
+           post_ms[(post_ms.size() * 99) / 100], post_ms.back());
+    if (iters > 1)
+    {
+        printf("post_process steady-state allocations: %zu\n", steady_allocs);
+        if (steady_allocs != 0)
+            return 1;
+    }
+
+    const std::string golden_path = dir + "/golden.txt";
+    if (write_golden)
+    {
+        FILE *fp = fopen(golden_path.c_str(), "w");
+        if (!fp)
+        {
+            printf("open %s failed\n", golden_path.c_str());
+            return -1;
+        }
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            const Box &b = result[i].box;
+            fprintf(fp, "%ld %d %.6f %.4f %.4f %.4f %.4f\n", result[i].frame, b.cls, b.score,
+                    b.x1, b.y1, b.x2, b.y2);
+        }
+        fclose(fp);
+        printf("golden written: %s\n", golden_path.c_str());
+        return 0;
+    }
+
+    std::vector<GoldenBox> golden;
+    if (load_golden(golden_path, golden) != 0)
+    {
+        printf("no golden (%s), run with --write-golden first\n", golden_path.c_str());
+        return 0;
+    }
+    size_t mismatch = golden.size() > result.size() ? golden.size() - result.size()
+                                                    : result.size() - golden.size();
+    for (size_t i = 0; i < golden.size() && i < result.size(); i++)
+    {
+        if (golden[i].frame != result[i].frame || !same_box(golden[i].box, result[i].box))
+            mismatch++;
+    }
+    printf("golden check: %zu / %zu boxes differ\n", mismatch, golden.size());
+    return mismatch ? 1 : 0;
+}
@@ -11,63 +11,7 @@
 #include "RgaUtils.h"
 #include "RgaApi.h"
 
-#include <sys/ioctl.h>
-#include <sys/mman.h>
-#include <linux/dma-heap.h>
-
-// -----------------------------
-// RV1106 DMA allocator
-// -----------------------------
-static int dma_alloc(int size, int *fd, void **ptr)
-{
-    const char *heap_path = "/dev/rk_dma_heap/rk-dma-heap-cma";
-    int heap_fd = open(heap_path, O_RDWR);
-    if (heap_fd < 0)
-    {
-        perror("open rk-dma-heap-cma failed");
-        return -1;
-    }
-
-    struct dma_heap_allocation_data alloc_data;
-    memset(&alloc_data, 0, sizeof(alloc_data));
-    alloc_data.len = size;
-    alloc_data.fd_flags = O_RDWR | O_CLOEXEC;
-    alloc_data.heap_flags = 0;
-
-    if (ioctl(heap_fd, DMA_HEAP_IOCTL_ALLOC, &alloc_data) < 0)
-    {
-        perror("DMA_HEAP_IOCTL_ALLOC failed");
-        close(heap_fd);
-        return -1;
-    }
-
-    *fd = alloc_data.fd;
-
-    *ptr = mmap(NULL,
-                size,
-                PROT_READ | PROT_WRITE,
-                MAP_SHARED,
-                *fd,
-                0);
-    if (*ptr == MAP_FAILED)
-    {
-        perror("mmap failed");
-        close(*fd);
-        close(heap_fd);
-        return -1;
-    }
-
-    close(heap_fd);
-    return 0;
-}
-
-static void dma_free(int fd, void *ptr, int size)
-{
-    if (ptr)
-        munmap(ptr, size);
-    if (fd >= 0)
-        close(fd);
-}
+#include "dma_pool.h"
 
 // -----------------------------
 // 主函数
@@ -118,20 +62,22 @@ int main(int argc, char **argv)
     }
 
     size_t src_size = in_w * in_h * 4;
-    int src_fd;
-    void *src_dma;
-    if (dma_alloc(src_size, &src_fd, &src_dma) < 0)
+    // 解码、CPU letterbox、编码都在 CPU 上，缓冲都走带 cache 的 heap，访问前后 sync
+    DmaBuffer src_buf = dma_pool_cached().acquire(src_size);
+    if (!src_buf)
     {
-        printf("dma_alloc src failed\n");
+        printf("dma pool acquire src failed\n");
         return -1;
     }
 
-    if (tjDecompress2(tjd, jpg_buf, jpg_size, (unsigned char *)src_dma,
+    src_buf.sync_begin(DMA_BUF_SYNC_WRITE);
+    if (tjDecompress2(tjd, jpg_buf, jpg_size, (unsigned char *)src_buf.virt(),
                       in_w, in_w * 4, in_h, TJPF_RGBA, TJFLAG_FASTDCT) != 0)
     {
         printf("tjDecompress2 failed: %s\n", tjGetErrorStr());
         return -1;
     }
+    src_buf.sync_end(DMA_BUF_SYNC_WRITE);
 
     tjDestroy(tjd);
     delete[] jpg_buf;
@@ -150,11 +96,9 @@ int main(int argc, char **argv)
     // -----------------------------
     // 4. RGA resize 到临时 buffer
     // -----------------------------
-    int tmp_fd;
-    void *tmp_dma;
-    dma_alloc(resize_w * resize_h * 4, &tmp_fd, &tmp_dma);
-    rga_buffer_t src = wrapbuffer_fd(src_fd, in_w, in_h, RK_FORMAT_RGBA_8888);
-    rga_buffer_t dst_resize = wrapbuffer_fd(tmp_fd, resize_w, resize_h, RK_FORMAT_RGBA_8888);
+    DmaBuffer tmp_buf = dma_pool_cached().acquire(resize_w * resize_h * 4);
+    rga_buffer_t src = wrapbuffer_fd(src_buf.fd(), in_w, in_h, RK_FORMAT_RGBA_8888);
+    rga_buffer_t dst_resize = wrapbuffer_fd(tmp_buf.fd(), resize_w, resize_h, RK_FORMAT_RGBA_8888);
 
     double fx = (double)resize_w / in_w;
     double fy = (double)resize_h / in_h;
@@ -171,19 +115,20 @@ int main(int argc, char **argv)
     // 5. 分配最终 640x640 DMA 输出 buffer
     // -----------------------------
     size_t dst_size = target_size * target_size * 4;
-    int dst_fd;
-    void *dst_dma;
-    if (dma_alloc(dst_size, &dst_fd, &dst_dma) < 0)
+    DmaBuffer dst_buf = dma_pool_cached().acquire(dst_size);
+    if (!dst_buf)
     {
-        printf("dma_alloc dst failed\n");
+        printf("dma pool acquire dst failed\n");
         return -1;
     }
 
     // -----------------------------
     // 6. CPU memcpy + padding 实现 letterbox
     // -----------------------------
-    unsigned char *dst_ptr = (unsigned char *)dst_dma;
-    unsigned char *resize_ptr = (unsigned char *)tmp_dma;
+    unsigned char *dst_ptr = (unsigned char *)dst_buf.virt();
+    unsigned char *resize_ptr = (unsigned char *)tmp_buf.virt();
+    tmp_buf.sync_begin(DMA_BUF_SYNC_READ);
+    dst_buf.sync_begin(DMA_BUF_SYNC_RW);
     memset(dst_ptr, 0, dst_size); // RGBA 黑色背景
 
     for (int y = 0; y < resize_h; y++)
@@ -194,7 +139,8 @@ int main(int argc, char **argv)
             resize_w * 4);
     }
 
-    dma_free(tmp_fd, tmp_dma, resize_w * resize_h * 4);
+    tmp_buf.sync_end(DMA_BUF_SYNC_READ);
+    tmp_buf.reset();
 
     auto t4 = std::chrono::high_resolution_clock::now();
 
@@ -205,7 +151,7 @@ int main(int argc, char **argv)
     unsigned char *out_jpg_buf = nullptr;
     unsigned long out_jpg_size = 0;
 
-    if (tjCompress2(tjc, (unsigned char *)dst_dma,
+    if (tjCompress2(tjc, (unsigned char *)dst_buf.virt(),
                     target_size, target_size * 4, target_size,
                     TJPF_RGBA,
                     &out_jpg_buf, &out_jpg_size,
@@ -219,11 +165,12 @@ int main(int argc, char **argv)
     fwrite(out_jpg_buf, 1, out_jpg_size, fo);
     fclose(fo);
 
+    dst_buf.sync_end(DMA_BUF_SYNC_RW);
     tjFree(out_jpg_buf);
     tjDestroy(tjc);
 
-    dma_free(src_fd, src_dma, src_size);
-    dma_free(dst_fd, dst_dma, dst_size);
+    src_buf.reset();
+    dst_buf.reset();
 
     auto t5 = std::chrono::high_resolution_clock::now();
 
@@ -238,6 +185,7 @@ int main(int argc, char **argv)
 
     printf("decode: %.3f ms, resize: %.3f ms, padding: %.3f ms, encode: %.3f ms, total: %.3f ms\n",
            decode_jpg_ms, resize_ms, padding_ms, encode_ms, total_ms);
+    dma_pool_cached().print_stats();
 
     return 0;
 }
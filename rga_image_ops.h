@@ -0,0 +1,142 @@
+/*******************************************************
+ * rga_image_ops.h
+ * ImageOps 的 RGA 实现: 缩放/色彩转换直接写目标矩形，填充走 imfill
+ *******************************************************/
+#ifndef RGA_IMAGE_OPS_H
+#define RGA_IMAGE_OPS_H
+
+#include <stdio.h>
+
+#include "im2d.h"
+#include "RgaApi.h"
+
+#include "image_ops.h"
+
+static inline int rga_format(int format)
+{
+    switch (format)
+    {
+    case PIXEL_RGBA8888:
+        return RK_FORMAT_RGBA_8888;
+    case PIXEL_RGB888:
+        return RK_FORMAT_RGB_888;
+    case PIXEL_YUV420P:
+        return RK_FORMAT_YCbCr_420_P;
+    case PIXEL_YUV422P:
+        return RK_FORMAT_YCbCr_422_P;
+    case PIXEL_NV12:
+        return RK_FORMAT_YCbCr_420_SP;
+    case PIXEL_YUYV:
+        return RK_FORMAT_YUYV_422;
+    case PIXEL_GRAY8:
+        return RK_FORMAT_YCbCr_400;
+    default:
+        return RK_FORMAT_UNKNOWN;
+    }
+}
+
+static inline rga_buffer_t rga_wrap(const ImageBuffer &b)
+{
+    return wrapbuffer_fd(b.fd, b.width, b.height, rga_format(b.format),
+                         b.wstride, b.hstride);
+}
+
+// YUV -> RGB 时按源的取值范围选 CSC 模式；其他组合（含输出灰度）不用设
+static inline void rga_set_csc(const ImageBuffer &src, const ImageBuffer &dst, rga_buffer_t *d)
+{
+    if (pixel_is_yuv(src.format) && !pixel_is_yuv(dst.format) && dst.format != PIXEL_GRAY8)
+        d->color_space_mode = src.yuv_range == YUV_RANGE_LIMITED ? IM_YUV_TO_RGB_BT601_LIMIT
+                                                                 : IM_YUV_TO_RGB_BT601_FULL;
+}
+
+static inline im_rect rga_rect(const ImageRect &r)
+{
+    im_rect rect;
+    rect.x = r.x;
+    rect.y = r.y;
+    rect.width = r.w;
+    rect.height = r.h;
+    return rect;
+}
+
+class RgaImageOps : public ImageOps
+{
+public:
+    int resize(const ImageBuffer &src, const ImageRect &srect,
+               const ImageBuffer &dst, const ImageRect &drect) override
+    {
+        rga_buffer_t s = rga_wrap(src);
+        rga_buffer_t d = rga_wrap(dst);
+        // 缩放和色彩转换一次完成
+        rga_set_csc(src, dst, &d);
+        rga_buffer_t pat;
+        memset(&pat, 0, sizeof(pat));
+        im_rect prect;
+        memset(&prect, 0, sizeof(prect));
+
+        int ret = improcess(s, d, pat, rga_rect(srect), rga_rect(drect), prect, IM_SYNC);
+        if (ret != IM_STATUS_SUCCESS)
+        {
+            printf("RGA resize failed: %s\n", imStrError((IM_STATUS)ret));
+            return -1;
+        }
+        return 0;
+    }
+
+    // 所有裁剪合成一个 RGA job 一次提交，只等一次完成
+    int crop_batch(const ImageBuffer &src, const ImageRect *srects,
+                   const ImageBuffer *dsts, int n) override
+    {
+        if (n <= 0)
+            return 0;
+        im_job_handle_t job = imbeginJob();
+        if (!job)
+        {
+            printf("RGA imbeginJob failed\n");
+            return -1;
+        }
+
+        rga_buffer_t s = rga_wrap(src);
+        rga_buffer_t pat;
+        memset(&pat, 0, sizeof(pat));
+        im_rect prect;
+        memset(&prect, 0, sizeof(prect));
+        for (int i = 0; i < n; i++)
+        {
+            rga_buffer_t d = rga_wrap(dsts[i]);
+            rga_set_csc(src, dsts[i], &d);
+            int ret = improcessTask(job, s, d, pat, rga_rect(srects[i]),
+                                    rga_rect(make_rect(0, 0, dsts[i].width, dsts[i].height)),
+                                    prect, 0);
+            if (ret != IM_STATUS_SUCCESS)
+            {
+                printf("RGA crop task %d failed: %s\n", i, imStrError((IM_STATUS)ret));
+                imcancelJob(job);
+                return -1;
+            }
+        }
+
+        int ret = imendJob(job, IM_SYNC);
+        if (ret != IM_STATUS_SUCCESS)
+        {
+            printf("RGA crop batch failed: %s\n", imStrError((IM_STATUS)ret));
+            return -1;
+        }
+        return 0;
+    }
+
+    int fill(const ImageBuffer &dst, const ImageRect &rect, uint8_t value) override
+    {
+        rga_buffer_t d = rga_wrap(dst);
+        int color = (int)(0xff000000u | (value << 16) | (value << 8) | value);
+        int ret = imfill(d, rga_rect(rect), color);
+        if (ret != IM_STATUS_SUCCESS)
+        {
+            printf("RGA fill failed: %s\n", imStrError((IM_STATUS)ret));
+            return -1;
+        }
+        return 0;
+    }
+};
+
+#endif
@@ -0,0 +1,266 @@
+/*******************************************************
+ * rknn_cascade_demo.cpp
+ * 检测 + 分类级联: YOLOv8 找目标，MobileNet 给每个目标分类。
+ * 两个模型常驻同一进程；每张图只解码一次，检测框直接从解码出的
+ * DMA 源图上一批裁剪（一个 RGA job）进分类器的 slot 输入，
+ * 再逐个 rknn_run。每个目标的额外开销是一次裁剪、一次 rknn_run，
+ * 以及换 slot 时的 rknn_set_io_mem（次数和耗时见 classifier 的 infer 统计）。
+ *******************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include "rknn_api.h"
+#include "im2d.h"
+#include "RgaApi.h"
+#include <turbojpeg.h>
+#include "rga_image_ops.h"
+#include "jpeg_decoder.h"
+#include "dma_pool.h"
+#include "infer.h"
+#include "yolov8_detector.h"
+#include "classifier_head.h"
+#include "coco_labels.h"
+#include "trace.h"
+#include "model_file.h"
+#include "batch_input.h"
+
+/* =================== 参数 =================== */
+#define CONF_THRESH 0.25f
+#define NMS_THRESH 0.45f
+#define MAX_DET 300
+#define CASCADE_BATCH 8  // 分类器输入 slot 数，一次 RGA job 最多裁这么多
+#define CASCADE_MIN_SIZE 8 // 小于这个边长的框不分类
+#define DECODE_AHEAD 4       // 解好等着检测的图片数上限
+
+/* =================== 级联 =================== */
+class Cascade
+{
+public:
+    Cascade(YoloDetector &detector, Infer &cls_infer, ClassifierHead &head, ImageOps &ops)
+        : detector(detector), cls_infer(cls_infer), head(head), ops(ops), crops(0)
+    {
+        // 分类器每个 slot 的输入张量描述，按 native w_stride
+        const rknn_tensor_attr &in = cls_infer.input_attr();
+        for (int i = 0; i < cls_infer.num_slots(); i++)
+            cls_inputs.push_back(make_image_buffer(cls_infer.input_mem(i)->fd,
+                                                   cls_infer.input_mem(i)->virt_addr,
+                                                   cls_infer.model_width(),
+                                                   cls_infer.model_height(),
+                                                   PIXEL_RGB888, in.w_stride));
+        // 裁剪一步缩放到分类器输入，框边长要落在 RGA 的 1/16 ~ 16 倍以内
+        const int cls_w = cls_infer.model_width(), cls_h = cls_infer.model_height();
+        min_w = std::max(CASCADE_MIN_SIZE, (cls_w + RGA_MAX_SCALE - 1) / RGA_MAX_SCALE);
+        min_h = std::max(CASCADE_MIN_SIZE, (cls_h + RGA_MAX_SCALE - 1) / RGA_MAX_SCALE);
+        max_w = cls_w * RGA_MAX_SCALE;
+        max_h = cls_h * RGA_MAX_SCALE;
+        boxes.reserve(MAX_DET);
+        rects.reserve(MAX_DET);
+        owners.reserve(MAX_DET);
+        results.reserve(MAX_DET);
+    }
+
+    // img 由 DecodeAhead 解好，源图一直留到裁剪结束，检测和分类共用
+    int process(const IngestFrame &img)
+    {
+        if (!img.ok)
+            return -1;
+        const ImageBuffer &frame = img.image;
+
+        if (detector.detect(frame, boxes) != 0)
+            return -1;
+        if (classify_boxes(frame) != 0)
+            return -1;
+
+        const float sx = img.scale_x();
+        const float sy = img.scale_y();
+        printf("%s: %zu objects\n", img.path, boxes.size());
+        for (size_t k = 0; k < boxes.size(); k++)
+        {
+            const Box &b = boxes[k];
+            char det_name[16];
+            const char *label = coco_label(b.cls, detector.num_classes(), det_name,
+                                           sizeof(det_name));
+            printf("%s %.3f [%d %d %d %d]", label, b.score,
+                   (int)(b.x1 * sx), (int)(b.y1 * sy), (int)(b.x2 * sx), (int)(b.y2 * sy));
+            if (results[k].cls >= 0)
+                printf(" -> class=%d score=%.4f", results[k].cls, results[k].prob);
+            printf("\n");
+        }
+        return 0;
+    }
+
+    long crop_count() const { return crops; }
+
+private:
+    // 框（frame 坐标）取整成裁剪矩形，太小或超出 RGA 缩放范围的返回 false
+    bool box_rect(const Box &b, int frame_w, int frame_h, ImageRect *r) const
+    {
+        int x1 = (int)b.x1, y1 = (int)b.y1;
+        int x2 = (int)(b.x2 + 0.5f), y2 = (int)(b.y2 + 0.5f);
+        x2 = x2 < frame_w ? x2 : frame_w;
+        y2 = y2 < frame_h ? y2 : frame_h;
+        const int w = x2 - x1, h = y2 - y1;
+        if (w < min_w || h < min_h || w > max_w || h > max_h)
+            return false;
+        *r = make_rect(x1, y1, x2 - x1, y2 - y1);
+        return true;
+    }
+
+    // 每批最多 slot 数个框: 一个 RGA job 裁完，再逐个 slot rknn_run + top-1
+    int classify_boxes(const ImageBuffer &frame)
+    {
+        results.resize(boxes.size());
+        rects.clear();
+        owners.clear();
+        for (size_t k = 0; k < boxes.size(); k++)
+        {
+            results[k].cls = -1;
+            results[k].prob = 0;
+            ImageRect r;
+            if (box_rect(boxes[k], frame.width, frame.height, &r))
+            {
+                rects.push_back(r);
+                owners.push_back((int)k);
+            }
+        }
+
+        const int batch = (int)cls_inputs.size();
+        for (size_t first = 0; first < rects.size(); first += batch)
+        {
+            int n = (int)rects.size() - (int)first;
+            n = n < batch ? n : batch;
+            {
+                TRACE_SPAN("crop_batch");
+                if (ops.crop_batch(frame, &rects[first], cls_inputs.data(), n) != 0)
+                    return -1;
+            }
+            crops += n;
+
+            for (int i = 0; i < n; i++)
+            {
+                {
+                    TRACE_SPAN("cls_run");
+                    if (cls_infer.run(i) != 0)
+                        return -1;
+                }
+                TRACE_SPAN("classify");
+                head.run(cls_infer.outputs(i)[0], &results[owners[first + i]]);
+            }
+        }
+        return 0;
+    }
+
+    YoloDetector &detector;
+    Infer &cls_infer;
+    ClassifierHead &head;
+    ImageOps &ops;
+    long crops;
+    int min_w, min_h, max_w, max_h; // 参与分类的框边长范围
+
+    std::vector<ImageBuffer> cls_inputs;
+    std::vector<Box> boxes;
+    std::vector<ImageRect> rects; // 这一帧要分类的框
+    std::vector<int> owners;      // rects[i] 对应 boxes 的下标
+    std::vector<ClassScore> results;
+};
+
+/* =================== main =================== */
+int main(int argc, char **argv)
+{
+    // 图片参数可以是文件、目录、glob（记得加引号）或 "-"（stdin 每行一个路径）
+    // --decoders N: 解码线程数（默认 1）
+    int decoders = 1;
+    std::vector<std::string> images;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--decoders") == 0 && i + 1 < argc)
+            decoders = atoi(argv[++i]);
+        else if (collect_images(argv[i], images) != 0)
+            return -1;
+    }
+    if (argc < 4 || images.empty())
+    {
+        printf("Usage: %s yolov8.rknn mobilenet.rknn image.jpg|DIR|'GLOB'|- [...] "
+               "[--decoders N]\n", argv[0]);
+        return -1;
+    }
+
+    /******************** 两个引擎都只初始化一次 ********************/
+    // 模型文件只读 mmap，各自 rknn_init 完就解除映射，两份模型不会同时占着页缓存
+    ModelFile det_model, cls_model;
+    std::unique_ptr<Infer> det_infer, cls_infer;
+    try
+    {
+        if (det_model.open(argv[1]) != 0)
+            return -1;
+        det_infer.reset(new Infer(det_model.data(), det_model.size()));
+        det_model.release();
+        if (cls_model.open(argv[2]) != 0)
+            return -1;
+        cls_infer.reset(new Infer(cls_model.data(), cls_model.size()));
+        cls_model.release();
+    }
+    catch (const std::exception &e)
+    {
+        printf("%s\n", e.what());
+        return -1;
+    }
+    // 分类器的一组输入（每个 slot 一套 io mem），裁剪批量写进去
+    if (cls_infer->create_slots(CASCADE_BATCH) != 0)
+    {
+        printf("create classifier slots failed\n");
+        return -1;
+    }
+
+    RgaImageOps rga_ops;
+    YoloDetector detector(*det_infer, rga_ops, CONF_THRESH, NMS_THRESH, MAX_DET);
+    if (detector.init() != 0)
+        return -1;
+
+    // 分类输出是 [1, N]，native NHWC 下 N 个元素连续
+    ClassifierHead head;
+    if (head.init(cls_infer->output_native_attrs()[0], 1) != 0)
+        return -1;
+
+    Cascade cascade(detector, *cls_infer, head, rga_ops);
+
+    /******************** 逐张 ********************/
+    // DCT 缩放只照顾检测输入；裁剪来自缩小后的源图，小目标分辨率会跟着降
+    auto t0 = std::chrono::steady_clock::now();
+    DecodeTarget target = {det_infer->model_width(), det_infer->model_height(), true,
+                           JPEG_INGEST_RGBA};
+    DecodeAhead source(images, target, decoders, DECODE_AHEAD);
+    int nimg = 0;
+    IngestFrame img;
+    while (source.next(img))
+    {
+        if (cascade.process(img) != 0)
+            printf("%s: failed\n", img.path);
+        else
+            nimg++;
+    }
+    double wall_ms = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - t0)
+                         .count();
+
+    /******************** stats ********************/
+    printf("detector ");
+    det_model.print_stats();
+    printf("detector ");
+    det_infer->print_stats();
+    printf("classifier ");
+    cls_model.print_stats();
+    printf("classifier ");
+    cls_infer->print_stats();
+    printf("peak rss: %ld KB\n", peak_rss_kb());
+    tracer().print_stats();
+    source.print_stats();
+    printf("cascade: %d/%zu images, %ld crops in %.3f ms, %.2f images/s\n", nimg,
+           images.size(), cascade.crop_count(), wall_ms, nimg * 1000.0 / wall_ms);
+    dma_pool_cached().print_stats();
+    return 0;
+}
@@ -6,140 +6,40 @@
 #include <iostream>
 #include <cstring>
 
-class Infer
-{
-public:
-    Infer(const void *model_buffer, size_t buffer_size)
-    {
-        int ret = rknn_init(&this->ctx, const_cast<void *>(model_buffer),
-                            (uint32_t)buffer_size, 0, NULL);
-        if (ret != RKNN_SUCC)
-        {
-            throw std::runtime_error("rknn_init failed: " + std::to_string(ret));
-        }
-
-        // 获取输入数量 + 输入属性信息
-        rknn_input_output_num io_num2;
-        ret = rknn_query(this->ctx, RKNN_QUERY_IN_OUT_NUM, &io_num2, sizeof(io_num2));
-        if (ret != RKNN_SUCC)
-            throw std::runtime_error("RKNN_QUERY_IN_OUT_NUM failed: " + std::to_string(ret));
-
-        input_num = io_num2.n_input;
-
-        input_attrs.resize(input_num);
-        for (int i = 0; i < input_num; ++i)
-        {
-            rknn_tensor_attr &attr = input_attrs[i];
-            memset(&attr, 0, sizeof(attr));
-            attr.index = i;
-
-            ret = rknn_query(this->ctx, RKNN_QUERY_INPUT_ATTR, &attr, sizeof(attr));
-            if (ret != RKNN_SUCC)
-                throw std::runtime_error("RKNN_QUERY_INPUT_ATTR failed: " + std::to_string(ret));
-        }
-
-        // 输出输入属性信息
-        std::cout << "RKNN input num: " << input_num << std::endl;
-        for (int i = 0; i < input_num; ++i)
-        {
-            auto &a = input_attrs[i];
-            std::cout << "Input " << i << " shape: ";
-            for (uint32_t j = 0; j < a.n_dims; ++j)
-                std::cout << a.dims[j] << " ";
-
-            std::cout << "\n"
-                      << std::endl;
-            std::cout << "data_type=" << get_type_string(a.type) << "\n"
-                      << "data_format=" << get_format_string(a.fmt) << "\n"
-                      << "qnt_type=" << get_qnt_type_string(a.qnt_type) << "\n"
-                      << std::endl;
-        }
-
-        // 获取输出数量
-        rknn_input_output_num io_num;
-        ret = rknn_query(this->ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
-        if (ret != RKNN_SUCC)
-            throw std::runtime_error("RKNN_QUERY_IN_OUT_NUM failed: " + std::to_string(ret));
+#include "infer.h"
+#include "model_file.h"
 
-        output_num = io_num.n_output;
-
-        // 获取每个输出的维度信息
-        output_attrs.resize(output_num);
-        for (int i = 0; i < output_num; ++i)
-        {
-            rknn_tensor_attr &attr = output_attrs[i];
-            memset(&attr, 0, sizeof(attr));
-            attr.index = i;
-
-            rknn_query(this->ctx, RKNN_QUERY_OUTPUT_ATTR, &attr, sizeof(attr));
-        }
-
-        std::cout << "RKNN output num: " << output_num << std::endl;
-        for (int i = 0; i < output_num; ++i)
-        {
-            auto &a = output_attrs[i];
-            std::cout << "Output " << i << " shape: ";
-            for (uint32_t j = 0; j < a.n_dims; ++j)
-                std::cout << a.dims[j] << " ";
-            std::cout << std::endl;
-        }
-    }
-
-    ~Infer()
+int main(int argc, char **argv)
+{
+    if (argc < 2)
     {
-        if (ctx)
-        {
-            rknn_destroy(ctx);
-            ctx = 0;
-        }
+        printf("Usage: %s model.rknn\n", argv[0]);
+        return -1;
     }
+    const char *model_path = argv[1];
 
-private:
-    rknn_context ctx = 0;
-    int input_num = 0;
-    int output_num = 0;
-
-    std::vector<rknn_tensor_attr> input_attrs;
-    std::vector<rknn_tensor_attr> output_attrs;
-};
-
-unsigned char *load_model(const char *filename, size_t *model_size)
-{
-    FILE *fp = fopen(filename, "rb");
-    if (!fp)
+    ModelFile model;
+    if (model.open(model_path) != 0)
     {
-        printf("Cannot open file: %s\n", filename);
-        return NULL;
+        printf("Load model failed\n");
+        return -1;
     }
 
-    fseek(fp, 0, SEEK_END);
-    int model_len = ftell(fp);
-    unsigned char *model = (unsigned char *)malloc(model_len);
-    fseek(fp, 0, SEEK_SET);
-    if ((size_t)model_len != fread(model, 1, model_len, fp))
+    try
     {
-
-        printf("fread %s fail!\n", filename);
-        free(model);
-        fclose(fp);
-        return NULL;
+        // 只看属性，不建 / 不绑 io mem
+        Infer infer(model.data(), model.size(), 0, NULL, false);
+        // rknn_init 之后运行时不再需要模型文件
+        model.release();
+        infer.print_attrs();
+        model.print_stats();
+        infer.print_stats();
+        printf("peak rss after init: %ld KB\n", peak_rss_kb());
     }
-    *model_size = model_len;
-    fclose(fp);
-    return model;
-}
-
-int main(int argc, char **argv)
-{
-    const char *model_path = argv[1];
-    size_t model_size;
-
-    unsigned char *model_data = load_model(model_path, &model_size);
-    if (!model_data)
+    catch (const std::exception &e)
     {
-        printf("Load model failed\n");
+        printf("%s\n", e.what());
         return -1;
     }
-
-    Infer infer(model_data, model_size);
-}
\ No newline at end of file
+    return 0;
+}
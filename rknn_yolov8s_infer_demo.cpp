@@ -9,381 +9,367 @@
 #include <vector>
 #include <algorithm>
 #include <chrono>
-
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/mman.h>
-#include <sys/ioctl.h>
-#include <linux/dma-heap.h>
+#include <memory>
 
 #include "rknn_api.h"
 #include "im2d.h"
 #include "RgaApi.h"
 #include <turbojpeg.h>
 
+#include "yolov8_postprocess.h"
+#include "preprocess.h"
+#include "rga_image_ops.h"
+#include "jpeg_decoder.h"
+#include "dma_pool.h"
+#include "infer.h"
+#include "yolov8_detector.h"
+#include "pipeline.h"
+#include "npu_replay.h"
+#include "coco_labels.h"
+#include "model_file.h"
+#include "batch_input.h"
+#include "stream_ingest.h"
+#include "v4l2_source.h"
+#include "motion_gate.h"
+
 /* =================== 参数 =================== */
-#define INPUT_W 640
-#define INPUT_H 640
-#define OBJ_CLASS_NUM 80
-#define DFL_LEN 16
 #define CONF_THRESH 0.25f
 #define NMS_THRESH 0.45f
-
-/* =================== COCO labels =================== */
-static const char *coco_labels[80] = {
-    "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat",
-    "traffic light", "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat",
-    "dog", "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe", "backpack", "umbrella",
-    "handbag", "tie", "suitcase", "frisbee", "skis", "snowboard", "sports ball", "kite",
-    "baseball bat", "baseball glove", "skateboard", "surfboard", "tennis racket", "bottle",
-    "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple", "sandwich", "orange",
-    "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair", "couch", "potted plant",
-    "bed", "dining table", "toilet", "tv", "laptop", "mouse", "remote", "keyboard", "cell phone",
-    "microwave", "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase", "scissors",
-    "teddy bear", "hair drier", "toothbrush"};
-
-/* =================== DMA =================== */
-static int dma_alloc(size_t size, int *fd, void **ptr)
+#define MAX_DET 300
+#define PIPELINE_SLOTS 3
+#define DECODE_AHEAD 4 // 解好等着进 NPU 的帧数上限
+#define STREAM_QUEUE 2 // 每路流最多积压的帧数
+
+/* =================== 工具 =================== */
+static double ms_between(std::chrono::steady_clock::time_point a,
+                         std::chrono::steady_clock::time_point b)
 {
-    int heap = open("/dev/rk_dma_heap/rk-dma-heap-cma", O_RDWR);
-    if (heap < 0)
-        return -1;
-
-    struct dma_heap_allocation_data data;
-    memset(&data, 0, sizeof(data));
-    data.len = size;
-    data.fd_flags = O_RDWR | O_CLOEXEC;
-
-    if (ioctl(heap, DMA_HEAP_IOCTL_ALLOC, &data) < 0)
-        return -1;
-
-    *fd = data.fd;
-    *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
-    close(heap);
-
-    return (*ptr == MAP_FAILED) ? -1 : 0;
+    return std::chrono::duration<double, std::milli>(b - a).count();
 }
 
-/* =================== DFL =================== */
-static void compute_dfl(const float *src, float *dst)
+/* =================== 逐帧阶段 =================== */
+// 准备(取解好的帧 + letterbox) / NPU / 后处理三段，顺序模式直接依次调用，
+// --pipeline 时交给 Pipeline 分线程、按 slot 轮转；帧来自文件清单（DecodeAhead）或实时流
+class YoloFrameStages : public PipelineStages
 {
-    for (int b = 0; b < 4; b++)
+public:
+    // nsources 为输入路数；gate 非空时静止帧跳过 NPU 和后处理，沿用同一路上一次的检测结果
+    YoloFrameStages(YoloDetector &detector, FrameSource &source, int slots, int nsources,
+                    MotionGate *gate)
+        : detector(detector), source(source), gate(gate), jobs(slots), last_boxes(nsources),
+          completed_(0)
     {
-        float sum = 0.f, acc = 0.f;
-        for (int i = 0; i < DFL_LEN; i++)
-        {
-            float v = expf(src[b * DFL_LEN + i]);
-            sum += v;
-            acc += v * i;
-        }
-        dst[b] = acc / sum;
+        for (size_t i = 0; i < last_boxes.size(); i++)
+            last_boxes[i].reserve(MAX_DET);
     }
-}
 
-/* =================== Box =================== */
-struct Box
-{
-    float x1, y1, x2, y2, score;
-    int cls;
-};
-
-/* =================== IoU & NMS =================== */
-static float iou(const Box &a, const Box &b)
-{
-    float xx1 = fmax(a.x1, b.x1);
-    float yy1 = fmax(a.y1, b.y1);
-    float xx2 = fmin(a.x2, b.x2);
-    float yy2 = fmin(a.y2, b.y2);
-    float w = fmax(0.f, xx2 - xx1);
-    float h = fmax(0.f, yy2 - yy1);
-    float inter = w * h;
-    float areaA = (a.x2 - a.x1) * (a.y2 - a.y1);
-    float areaB = (b.x2 - b.x1) * (b.y2 - b.y1);
-    return inter / (areaA + areaB - inter);
-}
+    bool prepare(int slot, long) override
+    {
+        IngestFrame img;
+        if (!source.next(img))
+            return false;
+        FrameJob &job = jobs[slot];
+        job.path = img.path;
+        job.index = img.index;
+        job.source = img.source;
+        job.t_capture_ns = img.t_capture_ns;
+        job.skipped = false;
+        job.ok = img.ok && prepare_frame(slot, img, job);
+        return true;
+    }
 
-static void nms(std::vector<Box> &boxes)
-{
-    std::sort(boxes.begin(), boxes.end(),
-              [](const Box &a, const Box &b)
-              { return a.score > b.score; });
-    std::vector<Box> out;
-    std::vector<int> remove(boxes.size(), 0);
+    int run(int slot) override
+    {
+        const FrameJob &job = jobs[slot];
+        if (!job.ok)
+            return -1;
+        return job.skipped ? 0 : detector.run(slot);
+    }
 
-    for (size_t i = 0; i < boxes.size(); i++)
+    void finish(int slot, long, int status) override
     {
-        if (remove[i])
-            continue;
-        out.push_back(boxes[i]);
-        for (size_t j = i + 1; j < boxes.size(); j++)
+        const FrameJob &job = jobs[slot];
+        if (status != 0)
         {
-            if (boxes[i].cls == boxes[j].cls &&
-                iou(boxes[i], boxes[j]) > NMS_THRESH)
-                remove[j] = 1;
+            printf("%s: failed\n", job.path);
+            return;
         }
-    }
-    boxes.swap(out);
-}
+        completed_++;
+        // 每路各留一份结果；帧按顺序 finish，跳过的帧拿到的就是这一路最近一次推理的结果
+        std::vector<Box> &boxes = last_boxes[job.source];
+        if (!job.skipped)
+            detector.postprocess(boxes, slot);
 
-/* =================== 后处理 RV1106 =================== */
-static void process_branch(
-    int8_t *box, int8_t *cls, int8_t *sum,
-    int gh, int gw, int stride,
-    rknn_tensor_attr &box_attr,
-    rknn_tensor_attr &cls_attr,
-    rknn_tensor_attr &sum_attr,
-    std::vector<Box> &out)
-{
-    // int grid = gh * gw;
-    int8_t sum_th = (int8_t)(CONF_THRESH / sum_attr.scale + sum_attr.zp);
-
-    for (int i = 0; i < gh; i++)
-        for (int j = 0; j < gw; j++)
+        if (job.t_capture_ns)
         {
-            int idx = i * gw + j;
-            if (sum && sum[idx] < sum_th)
-                continue;
-
-            int base = idx * OBJ_CLASS_NUM;
-            int best = -1;
-            int8_t best_q = -cls_attr.zp;
-
-            for (int c = 0; c < OBJ_CLASS_NUM; c++)
-            {
-                int8_t v = cls[base + c];
-                if (v > best_q)
-                {
-                    best_q = v;
-                    best = c;
-                }
-            }
-
-            float score = (best_q - cls_attr.zp) * cls_attr.scale;
-            if (score < CONF_THRESH)
-                continue;
-
-            float dfl[64];
-            int off = idx * 64;
-            for (int k = 0; k < 64; k++)
-                dfl[k] = (box[off + k] - box_attr.zp) * box_attr.scale;
-
-            float dist[4];
-            compute_dfl(dfl, dist);
+            // 流输入: 帧到齐 -> 检测结果出来
+            TRACE_RECORD("e2e_latency", job.t_capture_ns, Tracer::now_ns());
+            printf("%s #%ld: %zu objects%s\n", job.path, job.index, boxes.size(),
+                   job.skipped ? " (static, reused)" : "");
+        }
+        else
+            printf("%s: %zu objects%s\n", job.path, boxes.size(),
+                   job.skipped ? " (static, reused)" : "");
+        for (size_t k = 0; k < boxes.size(); k++)
+        {
+            const Box &b = boxes[k];
+            char cls_name[16];
+            const char *label = coco_label(b.cls, detector.num_classes(), cls_name,
+                                           sizeof(cls_name));
+            // 框从解码尺寸换回原图坐标
+            printf("%s %.3f [%d %d %d %d]\n",
+                   label, b.score,
+                   (int)(b.x1 * job.sx), (int)(b.y1 * job.sy),
+                   (int)(b.x2 * job.sx), (int)(b.y2 * job.sy));
+        }
+    }
 
-            float cx = (j + 0.5f) * stride;
-            float cy = (i + 0.5f) * stride;
+    // finish 时 status 为 0 的帧数，失败的（打不开 / 解码失败 / rknn_run 出错）不算
+    long completed() const { return completed_; }
 
-            Box b;
-            b.x1 = cx - dist[0] * stride;
-            b.y1 = cy - dist[1] * stride;
-            b.x2 = cx + dist[2] * stride;
-            b.y2 = cy + dist[3] * stride;
-            b.score = score;
-            b.cls = best;
-            out.push_back(b);
+private:
+    struct FrameJob
+    {
+        const char *path;
+        long index;
+        int source; // IngestFrame::source
+        uint64_t t_capture_ns;
+        bool ok;
+        bool skipped; // 运动门控判为静止，没有跑 NPU
+        float sx, sy; // 解码尺寸 -> 原图
+    };
+
+    // 解码帧 letterbox 进 slot 输入张量；RGA 同步完成，返回后源帧即可还回池子
+    bool prepare_frame(int slot, const IngestFrame &img, FrameJob &job)
+    {
+        job.sx = img.scale_x();
+        job.sy = img.scale_y();
+        if (gate && !gate->should_run(img.image, img.source))
+        {
+            job.skipped = true;
+            return true;
         }
-}
+        return detector.preprocess(img.image, slot) == 0;
+    }
+
+    YoloDetector &detector;
+    FrameSource &source;
+    MotionGate *gate;
+    std::vector<FrameJob> jobs;
+    std::vector<std::vector<Box>> last_boxes; // 按输入路，只在后处理阶段用
+    long completed_;
+};
 
 /* =================== main =================== */
 int main(int argc, char **argv)
 {
-    if (argc != 3)
+    // --yuv: JPEG 解成平面 YUV，由 RGA 一次完成缩放 + 色彩转换
+    // --pipeline: 准备 / NPU / 后处理三段分线程，PIPELINE_SLOTS 套 io mem 轮转
+    // --record DIR: 把属性查询和每帧的输入 / 输出张量录到 DIR，主机上用 replay_bench 回放
+    // --trace FILE: 每段计时写成 Chrome / Perfetto trace JSON
+    // --decoders N: 解码线程数（默认 1），读图 + 解码都在这些线程里提前做
+    // 图片参数可以是文件、目录、glob（记得加引号）或 "-"（stdin 每行一个路径）
+    // --stream SPEC: 实时流（可多路），见 stream_ingest.h；有流时不再接图片参数
+    // --latency-ms N: 流帧从到齐到开始处理的预算（默认 200），超过的旧帧丢掉
+    // --fps N: 文件冒充摄像头时的放帧速率（默认 0，不限速）
+    // --camera DEV:FMT:WxH [--frames N]: V4L2 摄像头（nv12 / yuyv），导出的 dma-buf 直接进 RGA；
+    //   N 帧后结束（默认 0，一直跑）
+    // --motion-gate [--gate-thresh F]: 流 / 摄像头画面静止时跳过 NPU，沿用这一路上一次结果；
+    //   F 为 8x8 块平均每像素亮度差的门限（默认 8）
+    int ingest = JPEG_INGEST_RGBA;
+    bool pipelined = false;
+    const char *record_dir = NULL;
+    const char *trace_path = NULL;
+    int decoders = 1;
+    std::vector<std::string> images;
+    std::vector<StreamSpec> stream_specs;
+    double latency_ms = 200;
+    double stream_fps = 0;
+    CameraSpec camera;
+    bool use_camera = false;
+    long camera_frames = 0;
+    bool motion_gate = false;
+    MotionGateConfig gate_cfg = motion_gate_defaults();
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--yuv") == 0)
+            ingest = JPEG_INGEST_YUV;
+        else if (strcmp(argv[i], "--pipeline") == 0)
+            pipelined = true;
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_dir = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            trace_path = argv[++i];
+        else if (strcmp(argv[i], "--decoders") == 0 && i + 1 < argc)
+            decoders = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+        {
+            StreamSpec spec;
+            if (parse_stream_spec(argv[++i], &spec) != 0)
+                return -1;
+            stream_specs.push_back(spec);
+        }
+        else if (strcmp(argv[i], "--camera") == 0 && i + 1 < argc)
+        {
+            if (parse_camera_spec(argv[++i], &camera) != 0)
+                return -1;
+            use_camera = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            camera_frames = atol(argv[++i]);
+        else if (strcmp(argv[i], "--latency-ms") == 0 && i + 1 < argc)
+            latency_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            stream_fps = atof(argv[++i]);
+        else if (strcmp(argv[i], "--motion-gate") == 0)
+            motion_gate = true;
+        else if (strcmp(argv[i], "--gate-thresh") == 0 && i + 1 < argc)
+            gate_cfg.block_thresh = (float)atof(argv[++i]);
+        else if (collect_images(argv[i], images) != 0)
+            return -1;
+    }
+    // 图片 / 流 / 摄像头三选一
+    const int modes = !images.empty() + !stream_specs.empty() + use_camera;
+    if (argc < 3 || modes != 1)
     {
-        printf("Usage: %s model.rknn image.jpg\n", argv[0]);
+        printf("Usage: %s model.rknn image.jpg|DIR|'GLOB'|- [...] [--yuv] [--pipeline] "
+               "[--record DIR] [--trace FILE] [--decoders N]\n"
+               "       %s model.rknn --stream SPEC [--stream SPEC ...] [--latency-ms N] "
+               "[--fps N] [--motion-gate] [--gate-thresh F] [--yuv] [--pipeline] [--trace FILE]\n"
+               "       %s model.rknn --camera DEV:nv12|yuyv:WxH [--frames N] [--motion-gate] "
+               "[--gate-thresh F] [--pipeline] [--trace FILE]\n",
+               argv[0], argv[0], argv[0]);
         return -1;
     }
-
-    const char *model_path = argv[1];
-    const char *img_path = argv[2];
-
-    /******************** 1. RKNN init ********************/
-    auto t1 = std::chrono::high_resolution_clock::now();
-    rknn_context ctx;
-    if (rknn_init(&ctx, (void *)model_path, 0, 0, NULL) != RKNN_SUCC)
+    // 门控比的是同一路相邻的帧，文件清单里每张图互不相干
+    if (motion_gate && !images.empty())
     {
-        printf("rknn_init failed\n");
+        printf("--motion-gate needs --stream or --camera\n");
         return -1;
     }
-
-    rknn_input_output_num io_num;
-    rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
-
-    /******************** 2. query input ********************/
-    auto t2 = std::chrono::high_resolution_clock::now();
-    rknn_tensor_attr in_attr;
-    memset(&in_attr, 0, sizeof(in_attr));
-    in_attr.index = 0;
-    rknn_query(ctx, RKNN_QUERY_NATIVE_INPUT_ATTR, &in_attr, sizeof(in_attr));
-
-    in_attr.type = RKNN_TENSOR_UINT8;
-    in_attr.fmt = RKNN_TENSOR_NHWC;
-
-    rknn_tensor_mem *input_mem = rknn_create_mem(ctx, in_attr.size_with_stride);
-    rknn_set_io_mem(ctx, input_mem, &in_attr);
-
-    /******************** 3. query outputs ********************/
-    auto t3 = std::chrono::high_resolution_clock::now();
-    rknn_tensor_attr out_attr[9];
-    rknn_tensor_mem *out_mem[9];
-
-    for (int i = 0; i < 9; i++)
+    if (motion_gate && stream_specs.size() > MOTION_MAX_STREAMS)
     {
-        memset(&out_attr[i], 0, sizeof(out_attr[i]));
-        out_attr[i].index = i;
-        rknn_query(ctx, RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR,
-                   &out_attr[i], sizeof(out_attr[i]));
-        out_mem[i] = rknn_create_mem(ctx, out_attr[i].size_with_stride);
-        rknn_set_io_mem(ctx, out_mem[i], &out_attr[i]);
+        printf("--motion-gate supports at most %d streams\n", MOTION_MAX_STREAMS);
+        return -1;
     }
+    const char *model_path = argv[1];
 
-    /******************** 4. read JPEG ********************/
-    auto t4 = std::chrono::high_resolution_clock::now();
-    FILE *fp = fopen(img_path, "rb");
-    if (!fp)
+    /******************** 引擎初始化（只做一次） ********************/
+    // rknn_init、属性查询、io mem 绑定、解码计划、候选/NMS 缓冲都在这里
+    std::unique_ptr<NpuRecordBackend> recorder;
+    if (record_dir)
+        recorder.reset(new NpuRecordBackend(*npu_default_backend(), record_dir));
+    ModelFile model;
+    if (model.open(model_path) != 0)
+        return -1;
+    std::unique_ptr<Infer> infer;
+    try
     {
-        printf("open image failed\n");
+        infer.reset(new Infer(model.data(), model.size(), 0, recorder.get()));
+    }
+    catch (const std::exception &e)
+    {
+        printf("%s\n", e.what());
         return -1;
     }
-    fseek(fp, 0, SEEK_END);
-    long jpg_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    unsigned char *jpg_buf = (unsigned char *)malloc(jpg_size);
-    fread(jpg_buf, 1, jpg_size, fp);
-    fclose(fp);
-
-    /******************** 5. JPEG -> RGBA (DMA) ********************/
-    auto t5 = std::chrono::high_resolution_clock::now();
-    tjhandle tjd = tjInitDecompress();
-    int img_w, img_h, subsamp, cs;
-    tjDecompressHeader3(tjd, jpg_buf, jpg_size,
-                        &img_w, &img_h, &subsamp, &cs);
-
-    int src_fd;
-    void *src_dma;
-    size_t src_size = img_w * img_h * 4;
-    dma_alloc(src_size, &src_fd, &src_dma);
-
-    tjDecompress2(tjd, jpg_buf, jpg_size,
-                  (unsigned char *)src_dma,
-                  img_w, img_w * 4, img_h,
-                  TJPF_RGBA, TJFLAG_FASTDCT);
-
-    tjDestroy(tjd);
-    free(jpg_buf);
-
-    /******************** 6. RGA resize ********************/
-    auto t6 = std::chrono::high_resolution_clock::now();
-    float scale = fmin(640.f / img_w, 640.f / img_h);
-    int resize_w = (int)(img_w * scale);
-    int resize_h = (int)(img_h * scale);
-
-    int resize_fd;
-    void *resize_dma;
-    dma_alloc(resize_w * resize_h * 4, &resize_fd, &resize_dma);
-
-    rga_buffer_t src = wrapbuffer_fd(src_fd, img_w, img_h, RK_FORMAT_RGBA_8888);
-    rga_buffer_t dst = wrapbuffer_fd(resize_fd, resize_w, resize_h, RK_FORMAT_RGBA_8888);
-
-    imresize(src, dst,
-             (double)resize_w / img_w,
-             (double)resize_h / img_h,
-             0, 1, NULL);
-
-    /******************** 7. letterbox to 640x640 RGB ********************/
-    auto t7 = std::chrono::high_resolution_clock::now();
-    int lb_fd;
-    void *lb_dma;
-    dma_alloc(640 * 640 * 3, &lb_fd, &lb_dma);
+    model.release();
 
-    memset(lb_dma, 114, 640 * 640 * 3);
-
-    int pad_x = (640 - resize_w) / 2;
-    int pad_y = (640 - resize_h) / 2;
+    const int slots = pipelined ? PIPELINE_SLOTS : 1;
+    if (infer->create_slots(slots) != 0)
+    {
+        printf("create io slots failed\n");
+        return -1;
+    }
 
-    unsigned char *src_rgba = (unsigned char *)resize_dma;
-    unsigned char *dst_rgb = (unsigned char *)lb_dma;
+    RgaImageOps rga_ops;
+    YoloDetector detector(*infer, rga_ops, CONF_THRESH, NMS_THRESH, MAX_DET);
+    if (detector.init() != 0)
+        return -1;
 
-    for (int y = 0; y < resize_h; y++)
+    /******************** 逐帧 ********************/
+    if (trace_path)
+        tracer().enable_events(images.empty() ? 1 << 18 : images.size() * 16);
+    auto t0 = std::chrono::steady_clock::now();
+    DecodeTarget target = {infer->model_width(), infer->model_height(), true, ingest};
+    StreamSignal signal; // 读线程会碰它，得比 streams 活得久
+    std::vector<std::unique_ptr<StreamIngest>> streams;
+    std::unique_ptr<FrameSource> source;
+    DecodeAhead *files = NULL;    // 文件模式时就是 source，留着打统计
+    V4l2FrameSource *cam = NULL; // 摄像头模式时就是 source
+    if (use_camera)
+    {
+        // 不解码: 摄像头缓冲直接交给 letterbox + CSC
+        cam = new V4l2FrameSource(camera, camera_frames);
+        source.reset(cam);
+        if (cam->start() != 0)
+            return -1;
+    }
+    else if (stream_specs.empty())
+    {
+        // 解码线程从这里开始跑在 NPU 前面
+        files = new DecodeAhead(images, target, decoders, DECODE_AHEAD);
+        source.reset(files);
+    }
+    else
     {
-        for (int x = 0; x < resize_w; x++)
+        // 每路一个读线程；解码在准备阶段做，只解没被丢掉的帧
+        std::vector<StreamIngest *> live;
+        for (size_t i = 0; i < stream_specs.size(); i++)
         {
-            unsigned char *s = src_rgba + (y * resize_w + x) * 4;
-            unsigned char *d = dst_rgb +
-                               ((y + pad_y) * 640 + (x + pad_x)) * 3;
-            d[0] = s[0];
-            d[1] = s[1];
-            d[2] = s[2];
+            streams.emplace_back(new StreamIngest(stream_specs[i], signal, STREAM_QUEUE,
+                                                  stream_fps));
+            if (streams.back()->start() != 0)
+                return -1;
+            live.push_back(streams.back().get());
         }
+        source.reset(new StreamFrameSource(live, target, signal, latency_ms));
     }
-
-    /******************** 8. copy to RKNN input ********************/
-    auto t8 = std::chrono::high_resolution_clock::now();
-    memcpy(input_mem->virt_addr, lb_dma, 640 * 640 * 3);
-
-    /******************** 9. run ********************/
-    auto t9 = std::chrono::high_resolution_clock::now();
-    rknn_run(ctx, NULL);
-
-    /******************** 10. post process ********************/
-    auto t10 = std::chrono::high_resolution_clock::now();
-    std::vector<Box> boxes;
-
-    process_branch((int8_t *)out_mem[0]->virt_addr,
-                   (int8_t *)out_mem[1]->virt_addr,
-                   (int8_t *)out_mem[2]->virt_addr,
-                   80, 80, 8,
-                   out_attr[0], out_attr[1], out_attr[2], boxes);
-
-    process_branch((int8_t *)out_mem[3]->virt_addr,
-                   (int8_t *)out_mem[4]->virt_addr,
-                   (int8_t *)out_mem[5]->virt_addr,
-                   40, 40, 16,
-                   out_attr[3], out_attr[4], out_attr[5], boxes);
-
-    process_branch((int8_t *)out_mem[6]->virt_addr,
-                   (int8_t *)out_mem[7]->virt_addr,
-                   (int8_t *)out_mem[8]->virt_addr,
-                   20, 20, 32,
-                   out_attr[6], out_attr[7], out_attr[8], boxes);
-
-    nms(boxes);
-
-    /******************** 11. output ********************/
-    auto t11 = std::chrono::high_resolution_clock::now();
-    for (auto &b : boxes)
+    std::unique_ptr<MotionGate> gate;
+    if (motion_gate)
     {
-        printf("%s %.3f [%d %d %d %d]\n",
-               coco_labels[b.cls], b.score,
-               (int)b.x1, (int)b.y1, (int)b.x2, (int)b.y2);
+        gate.reset(new MotionGate(rga_ops, gate_cfg));
+        if (gate->init() != 0)
+            return -1;
     }
-
-    /******************** 12. cleanup ********************/
-    auto t12 = std::chrono::high_resolution_clock::now();
-    double rknn_init_dration = std::chrono::duration<double, std::milli>(t2 - t1).count();
-    double rknn_query_dration = std::chrono::duration<double, std::milli>(t3 - t2).count();
-    double rknn_query_input_dration = std::chrono::duration<double, std::milli>(t4 - t3).count();
-    double rknn_query_outputs_dration = std::chrono::duration<double, std::milli>(t5 - t4).count();
-    double read_jpeg_dration = std::chrono::duration<double, std::milli>(t6 - t5).count();
-    double jpeg_rgba_dma_dration = std::chrono::duration<double, std::milli>(t7 - t6).count();
-    double rga_resize_dration = std::chrono::duration<double, std::milli>(t8 - t7).count();
-    double letterbox_dration = std::chrono::duration<double, std::milli>(t9 - t8).count();
-    double copy_to_rknn_input_dration = std::chrono::duration<double, std::milli>(t10 - t9).count();
-    double rknn_run_dration = std::chrono::duration<double, std::milli>(t11 - t10).count();
-    double post_process_dration = std::chrono::duration<double, std::milli>(t12 - t11).count();
-    double total_duration = std::chrono::duration<double, std::milli>(t12 - t1).count();
-    printf("rknn_init_dration:%.3f ms\n", rknn_init_dration);
-    printf("rknn_query_dration:%.3f ms\n", rknn_query_dration);
-    printf("rknn_query_input_dration:%.3f ms\n", rknn_query_input_dration);
-    printf("rknn_query_outputs_dration:%.3f ms\n", rknn_query_outputs_dration);
-    printf("read_jpeg_dration:%.3f ms\n", read_jpeg_dration);
-    printf("jpeg_rgba_dma_dration:%.3f ms\n", jpeg_rgba_dma_dration);
-    printf("rga_resize_dration:%.3f ms\n", rga_resize_dration);
-    printf("letterbox_dration:%.3f ms\n", letterbox_dration);
-    printf("copy_to_rknn_input_dration:%.3f ms\n", copy_to_rknn_input_dration);
-    printf("rknn_run_dration:%.3f ms\n", rknn_run_dration);
-    printf("post_process_dration:%.3f ms\n", post_process_dration);
-    printf("total_duration:%.3f ms\n", total_duration);
-    rknn_destroy(ctx);
+    const int nsources = stream_specs.empty() ? 1 : (int)stream_specs.size();
+    YoloFrameStages stages(detector, *source, slots, nsources, gate.get());
+    if (pipelined)
+    {
+        Pipeline pipeline(stages, slots);
+        pipeline.run();
+    }
+    else
+    {
+        for (long n = 0; stages.prepare(0, n); n++)
+            stages.finish(0, n, stages.run(0));
+    }
+    double wall_ms = ms_between(t0, std::chrono::steady_clock::now());
+    const long nframes = stages.completed();
+
+    /******************** stats ********************/
+    // 初始化开销只出现一次，逐帧各段看分位数
+    model.print_stats();
+    infer->print_stats();
+    printf("peak rss: %ld KB\n", peak_rss_kb());
+    tracer().print_stats();
+    if (files)
+        files->print_stats();
+    for (size_t i = 0; i < streams.size(); i++)
+        streams[i]->print_stats();
+    if (cam)
+        cam->print_stats();
+    if (gate)
+    {
+        // 省下的按真正推理过的帧的平均 预处理 + NPU + 后处理 估算
+        const DetectorStats &ds = detector.stats();
+        double per_frame = ds.frames ? (ds.preprocess_ms + ds.run_ms + ds.post_ms) / ds.frames : 0;
+        gate->print_stats(per_frame);
+    }
+    if (trace_path)
+        tracer().write_chrome_trace(trace_path);
+    printf("%s: %ld images in %.3f ms, %.2f images/s\n",
+           pipelined ? "pipelined" : "sequential", nframes, wall_ms,
+           nframes * 1000.0 / wall_ms);
+    dma_pool_cached().print_stats();
     return 0;
 }
@@ -0,0 +1,99 @@
+/*******************************************************
+ * spsc_queue.h
+ * 有界单生产者单消费者无锁环形队列，流水线各阶段之间传帧用
+ *******************************************************/
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// 等待时先让出 CPU 几轮，再短睡；RV1106 是单核，不能一直空转
+class SpinBackoff
+{
+public:
+    SpinBackoff() : spins(0) {}
+
+    void pause()
+    {
+        if (spins < 64)
+        {
+            spins++;
+            std::this_thread::yield();
+            return;
+        }
+        struct timespec ts = {0, 50 * 1000};
+        nanosleep(&ts, NULL);
+    }
+
+private:
+    int spins;
+};
+
+/*
+ * 容量向上取到 2 的幂。push 只能由一个线程调用，pop 只能由另一个线程调用；
+ * head / tail 分在不同 cache line，避免两端互相踢。
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity) : head(0), tail(0)
+    {
+        size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+        buf.resize(cap);
+        mask = cap - 1;
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    bool try_push(const T &v)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == buf.size())
+            return false;
+        buf[t & mask] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &v)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        v = buf[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(const T &v)
+    {
+        SpinBackoff backoff;
+        while (!try_push(v))
+            backoff.pause();
+    }
+
+    void pop(T &v)
+    {
+        SpinBackoff backoff;
+        while (!try_pop(v))
+            backoff.pause();
+    }
+
+    size_t capacity() const { return buf.size(); }
+
+private:
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    alignas(64) size_t mask;
+    std::vector<T> buf;
+};
+
+#endif
@@ -0,0 +1,689 @@
+/*******************************************************
+ * stream_ingest.h
+ * 实时流输入: 管道 / 文件 / TCP 上的 MJPEG 字节流（JPEG 首尾相接，
+ * 中间夹 multipart 头之类的杂字节也行），或定长的原始帧（V4L2 的文件替身）。
+ *
+ * 每路流一个读线程，切好的帧进有界队列；推理跟不上时丢最旧的帧，
+ * 取帧时再丢掉超过延迟预算的旧帧（至少留最新一帧），端到端延迟因此有上界，
+ * 不会随积压无限增长。丢帧发生在解码之前，丢掉的帧不花 CPU。
+ *******************************************************/
+#ifndef STREAM_INGEST_H
+#define STREAM_INGEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_input.h"
+#include "trace.h"
+
+#define MJPEG_MAX_FRAME (8 << 20)  // 超过就当作流坏了，丢掉重新找 SOI
+#define STREAM_READ_CHUNK (64 << 10)
+#define STREAM_POLL_MS 100         // 读线程检查退出标志的间隔
+
+/* =================== MJPEG 切帧 =================== */
+/*
+ * 增量切帧: 按 JPEG 段结构走（段长跳过，熵编码数据里只认真正的标记），
+ * 所以 APP 段里嵌的缩略图、数据里的 FF 00 / RSTn 都不会被当成帧尾；
+ * 渐进式 JPEG 的多个 SOS 也能走通。帧外的字节直接跳过。
+ */
+class MjpegParser
+{
+public:
+    MjpegParser()
+        : state(SEEK), prev_ff(false), tail_ff(false), marker(0), remain(0), ready(false),
+          corrupt(0)
+    {
+    }
+
+    /*
+     * 喂一段字节，返回用掉的字节数；切出一整帧时提前返回，
+     * 此时 frame_ready() 为 true，take() 取走后再接着喂剩下的。
+     */
+    size_t feed(const uint8_t *p, size_t n)
+    {
+        size_t i = 0;
+        size_t run = 0; // p[run, i) 属于当前帧、还没拷进 frame
+        while (i < n && !ready)
+        {
+            switch (state)
+            {
+            case SEEK:
+            {
+                uint8_t b = p[i++];
+                if (prev_ff && b == 0xD8)
+                {
+                    start_frame();
+                    run = i;
+                }
+                prev_ff = b == 0xFF;
+                break;
+            }
+            case EXPECT_FF:
+                if (p[i] != 0xFF)
+                {
+                    // 段后面不是标记，流坏了（多半是帧被截断、下一帧接着来了）；
+                    // 这个字节留给 SEEK 重新看，前一个字节是 FF 时正好接上新帧的 SOI
+                    bool ff = i > 0 ? p[i - 1] == 0xFF : tail_ff;
+                    drop_frame();
+                    prev_ff = ff;
+                    break;
+                }
+                i++;
+                state = MARKER;
+                break;
+            case MARKER:
+            case SCAN_FF:
+            {
+                uint8_t b = p[i++];
+                if (b == 0xFF)
+                    break; // 填充字节
+                if (state == SCAN_FF && (b == 0x00 || (b >= 0xD0 && b <= 0xD7)))
+                {
+                    // 熵编码数据里的字节填充和 RSTn
+                    state = SCAN;
+                    break;
+                }
+                if (b == 0xD9)
+                {
+                    frame.insert(frame.end(), p + run, p + i);
+                    ready = true;
+                    state = SEEK;
+                    prev_ff = false;
+                }
+                else if (b == 0xD8)
+                {
+                    // 上一帧没有 EOI 就开始了新帧
+                    corrupt++;
+                    start_frame();
+                    run = i;
+                }
+                else if (b == 0x01 || (b >= 0xD0 && b <= 0xD7))
+                    state = EXPECT_FF;
+                else if (b == 0x00)
+                    drop_frame(); // 段之间不该出现 FF 00
+                else
+                {
+                    marker = b;
+                    state = LEN_HI;
+                }
+                break;
+            }
+            case LEN_HI:
+                remain = (size_t)p[i++] << 8;
+                state = LEN_LO;
+                break;
+            case LEN_LO:
+                remain |= p[i++];
+                if (remain < 2)
+                {
+                    drop_frame();
+                    break;
+                }
+                remain -= 2;
+                state = remain ? BODY : after_segment();
+                break;
+            case BODY:
+            {
+                size_t take = n - i < remain ? n - i : remain;
+                i += take;
+                remain -= take;
+                if (!remain)
+                    state = after_segment();
+                break;
+            }
+            case SCAN:
+            {
+                const uint8_t *q = (const uint8_t *)memchr(p + i, 0xFF, n - i);
+                if (!q)
+                    i = n;
+                else
+                {
+                    i = q - p + 1;
+                    state = SCAN_FF;
+                }
+                break;
+            }
+            }
+        }
+
+        if (state != SEEK && !ready)
+        {
+            frame.insert(frame.end(), p + run, p + i);
+            if (frame.size() > MJPEG_MAX_FRAME)
+                drop_frame();
+        }
+        if (i > 0)
+            tail_ff = p[i - 1] == 0xFF;
+        return i;
+    }
+
+    bool frame_ready() const { return ready; }
+
+    // 整帧和 out 交换（out 原来的容量留给下一帧复用）
+    void take(std::vector<uint8_t> &out)
+    {
+        out.swap(frame);
+        frame.clear();
+        ready = false;
+    }
+
+    // 没有 EOI 就被打断 / 段结构不对 / 超长而丢掉的帧数
+    long corrupt_frames() const { return corrupt; }
+
+private:
+    enum State
+    {
+        SEEK,      // 找 FF D8
+        EXPECT_FF, // 段之间，下一个字节应是 FF
+        MARKER,    // 读过 FF，下一个是标记码
+        LEN_HI,
+        LEN_LO,
+        BODY, // 跳过段内容
+        SCAN, // 熵编码数据
+        SCAN_FF,
+    };
+
+    void start_frame()
+    {
+        frame.clear();
+        frame.push_back(0xFF);
+        frame.push_back(0xD8);
+        state = EXPECT_FF;
+    }
+
+    void drop_frame()
+    {
+        corrupt++;
+        frame.clear();
+        state = SEEK;
+        prev_ff = false;
+    }
+
+    State after_segment() const { return marker == 0xDA ? SCAN : EXPECT_FF; }
+
+    State state;
+    bool prev_ff;
+    bool tail_ff; // 上一次 feed 的最后一个字节是 FF
+    uint8_t marker;
+    size_t remain;
+    bool ready;
+    long corrupt;
+    std::vector<uint8_t> frame;
+};
+
+/* =================== 流描述 =================== */
+/*
+ * spec 写法:
+ *   -                          stdin 上的 MJPEG
+ *   tcp://host:port            连上去读 MJPEG（HTTP multipart 的头会被切帧跳过）
+ *   raw:FMT:WxH:PATH           PATH 上首尾相接的定长原始帧，
+ *                              FMT 为 rgba / rgb / i420 / yuv422p / nv12 / yuyv
+ *   其他                       文件或 FIFO 上的 MJPEG
+ */
+struct StreamSpec
+{
+    std::string name;
+    std::string path;
+    bool raw;
+    int format; // raw 时有效
+    int width, height;
+    int yuv_range; // raw YUV 的取值范围: 摄像头格式（nv12 / yuyv）按有限范围，其他按全范围
+};
+
+static inline int raw_format_from_name(const char *name)
+{
+    if (strcmp(name, "rgba") == 0)
+        return PIXEL_RGBA8888;
+    if (strcmp(name, "rgb") == 0)
+        return PIXEL_RGB888;
+    if (strcmp(name, "i420") == 0)
+        return PIXEL_YUV420P;
+    if (strcmp(name, "yuv422p") == 0)
+        return PIXEL_YUV422P;
+    if (strcmp(name, "nv12") == 0)
+        return PIXEL_NV12;
+    if (strcmp(name, "yuyv") == 0)
+        return PIXEL_YUYV;
+    return -1;
+}
+
+// 成功返回 0
+static inline int parse_stream_spec(const char *spec, StreamSpec *out)
+{
+    out->name = spec;
+    out->raw = false;
+    out->format = -1;
+    out->width = out->height = 0;
+    out->yuv_range = YUV_RANGE_FULL;
+    if (strncmp(spec, "raw:", 4) != 0)
+    {
+        out->path = spec;
+        return 0;
+    }
+
+    char fmt[16];
+    int consumed = 0;
+    if (sscanf(spec + 4, "%15[^:]:%dx%d:%n", fmt, &out->width, &out->height, &consumed) != 3 ||
+        !consumed || !spec[4 + consumed])
+    {
+        printf("bad raw stream spec %s (want raw:FMT:WxH:PATH)\n", spec);
+        return -1;
+    }
+    out->raw = true;
+    out->format = raw_format_from_name(fmt);
+    out->path = spec + 4 + consumed;
+    if (out->format == PIXEL_NV12 || out->format == PIXEL_YUYV)
+        out->yuv_range = YUV_RANGE_LIMITED;
+    if (out->format < 0 || out->width <= 0 || out->height <= 0 ||
+        (pixel_is_yuv(out->format) && ((out->width | out->height) & 1)))
+    {
+        printf("bad raw stream format %s %dx%d\n", fmt, out->width, out->height);
+        return -1;
+    }
+    return 0;
+}
+
+// 打开 spec 对应的可读 fd；失败返回 -1
+static inline int open_stream_fd(const StreamSpec &spec)
+{
+    if (spec.path == "-")
+        return dup(STDIN_FILENO);
+
+    if (spec.path.compare(0, 6, "tcp://") == 0)
+    {
+        std::string hostport = spec.path.substr(6);
+        size_t colon = hostport.rfind(':');
+        if (colon == std::string::npos)
+        {
+            printf("bad tcp address %s\n", spec.path.c_str());
+            return -1;
+        }
+        std::string host = hostport.substr(0, colon);
+        std::string port = hostport.substr(colon + 1);
+
+        struct addrinfo hints, *res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+        if (ret != 0)
+        {
+            printf("resolve %s failed: %s\n", spec.path.c_str(), gai_strerror(ret));
+            return -1;
+        }
+        int fd = -1;
+        for (struct addrinfo *ai = res; ai; ai = ai->ai_next)
+        {
+            fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0)
+                continue;
+            if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+                break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        if (fd < 0)
+            printf("connect %s failed: %s\n", spec.path.c_str(), strerror(errno));
+        return fd;
+    }
+
+    int fd = ::open(spec.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        printf("open %s failed: %s\n", spec.path.c_str(), strerror(errno));
+    return fd;
+}
+
+/* =================== 单路流 =================== */
+// 切好、还没解码的一帧；format < 0 表示 data 是 JPEG
+struct StreamFrame
+{
+    std::vector<uint8_t> data;
+    uint64_t t_ns; // 最后一个字节到达的时刻（Tracer::now_ns）
+    long seq;
+};
+
+struct StreamStats
+{
+    long received;      // 切出的完整帧
+    long processed;     // 交给推理的
+    long dropped_full;  // 队列满被挤掉的
+    long dropped_stale; // 取帧时已超过延迟预算的
+    long corrupt;       // 切帧时丢掉的坏帧
+};
+
+// 多路流共用一个，读线程有新帧 / 结束时叫醒消费方。
+// seq 在 mu 下递增: 消费方先记下 seq 再查队列，等的时候以 seq 变化为条件，不会漏掉通知
+struct StreamSignal
+{
+    StreamSignal() : seq(0) {}
+
+    std::mutex mu;
+    std::condition_variable cv;
+    uint64_t seq;
+};
+
+class StreamIngest
+{
+public:
+    /*
+     * queue_cap: 队列里最多等着的帧数；fps > 0 时按这个帧率放帧
+     * （文件冒充摄像头时用，管道 / socket 本身就有节奏，给 0）
+     */
+    StreamIngest(const StreamSpec &spec, StreamSignal &signal, int queue_cap, double fps)
+        : spec_(spec), signal(signal), fd(-1), ring(queue_cap < 1 ? 1 : queue_cap),
+          head(0), count(0), eof(false), stopping(false),
+          frame_interval_ns(fps > 0 ? (uint64_t)(1e9 / fps) : 0)
+    {
+        memset(&stats_, 0, sizeof(stats_));
+        if (spec_.raw)
+            raw_size = pixel_buffer_size(spec_.format, spec_.width, spec_.height);
+        else
+            raw_size = 0;
+    }
+
+    ~StreamIngest()
+    {
+        stop();
+        if (fd >= 0)
+            close(fd);
+    }
+
+    StreamIngest(const StreamIngest &) = delete;
+    StreamIngest &operator=(const StreamIngest &) = delete;
+
+    // 打开源并起读线程，成功返回 0
+    int start()
+    {
+        fd = open_stream_fd(spec_);
+        if (fd < 0)
+            return -1;
+        reader = std::thread(&StreamIngest::reader_loop, this);
+        return 0;
+    }
+
+    void stop()
+    {
+        stopping = true;
+        if (reader.joinable())
+            reader.join();
+    }
+
+    /*
+     * 取下一帧（和 out 交换，out 的旧缓冲回到队列里复用）。
+     * 比 budget_ns 更旧的帧直接丢，但队列里最新的一帧总会交出去。
+     */
+    bool pop(StreamFrame &out, uint64_t budget_ns)
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        if (!count)
+            return false;
+        const uint64_t now = Tracer::now_ns();
+        while (count > 1 && now - ring[head].t_ns > budget_ns)
+        {
+            head = (head + 1) % ring.size();
+            count--;
+            stats_.dropped_stale++;
+        }
+        std::swap(out, ring[head]);
+        head = (head + 1) % ring.size();
+        count--;
+        stats_.processed++;
+        return true;
+    }
+
+    // 读完且队列已空
+    bool finished()
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        return eof && !count;
+    }
+
+    const StreamSpec &spec() const { return spec_; }
+
+    StreamStats stats()
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        return stats_;
+    }
+
+    void print_stats()
+    {
+        StreamStats st = stats();
+        printf("stream %s: received %ld, processed %ld, dropped %ld (queue full %ld, stale %ld), "
+               "corrupt %ld\n",
+               spec_.name.c_str(), st.received, st.processed, st.dropped_full + st.dropped_stale,
+               st.dropped_full, st.dropped_stale, st.corrupt);
+    }
+
+private:
+    // 最多等 STREAM_POLL_MS 读一块，stop() 之后尽快返回；返回 read 的结果，超时返回 -2
+    ssize_t read_some(uint8_t *buf, size_t cap)
+    {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        int ret = poll(&pfd, 1, STREAM_POLL_MS);
+        if (ret == 0 || (ret < 0 && errno == EINTR))
+            return -2;
+        if (ret < 0)
+            return -1;
+        ssize_t got = read(fd, buf, cap);
+        if (got < 0 && (errno == EINTR || errno == EAGAIN))
+            return -2;
+        return got;
+    }
+
+    void reader_loop()
+    {
+        TRACE_THREAD_NAME(spec_.name.c_str());
+        std::vector<uint8_t> chunk(spec_.raw ? 0 : STREAM_READ_CHUNK);
+        StreamFrame spare;
+        size_t raw_got = 0;
+        next_release_ns = Tracer::now_ns();
+
+        while (!stopping)
+        {
+            if (spec_.raw)
+            {
+                // 定长帧: 直接读进待入队的缓冲，不经中间块
+                spare.data.resize(raw_size);
+                ssize_t got = read_some(spare.data.data() + raw_got, raw_size - raw_got);
+                if (got == -2)
+                    continue;
+                if (got <= 0)
+                    break;
+                raw_got += got;
+                if (raw_got == raw_size)
+                {
+                    raw_got = 0;
+                    publish(spare);
+                }
+                continue;
+            }
+
+            ssize_t got = read_some(chunk.data(), chunk.size());
+            if (got == -2)
+                continue;
+            if (got <= 0)
+                break;
+            size_t off = 0;
+            while (off < (size_t)got)
+            {
+                off += parser.feed(chunk.data() + off, got - off);
+                if (parser.frame_ready())
+                {
+                    parser.take(spare.data);
+                    publish(spare);
+                }
+            }
+            std::lock_guard<std::mutex> lock(mu);
+            stats_.corrupt = parser.corrupt_frames();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            stats_.corrupt = parser.corrupt_frames();
+            eof = true;
+        }
+        notify();
+    }
+
+    // 帧入队；满了挤掉最旧的。spare 换回被挤掉或空闲格子里的旧缓冲
+    void publish(StreamFrame &spare)
+    {
+        if (frame_interval_ns)
+        {
+            // 按帧率放帧，模拟摄像头的节奏
+            uint64_t now = Tracer::now_ns();
+            if (next_release_ns > now)
+                std::this_thread::sleep_for(std::chrono::nanoseconds(next_release_ns - now));
+            next_release_ns += frame_interval_ns;
+        }
+        spare.t_ns = Tracer::now_ns();
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            spare.seq = stats_.received++;
+            if (count == ring.size())
+            {
+                head = (head + 1) % ring.size();
+                count--;
+                stats_.dropped_full++;
+            }
+            std::swap(ring[(head + count) % ring.size()], spare);
+            count++;
+        }
+        notify();
+    }
+
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(signal.mu);
+            signal.seq++;
+        }
+        signal.cv.notify_all();
+    }
+
+    StreamSpec spec_;
+    StreamSignal &signal;
+    int fd;
+    size_t raw_size;
+    MjpegParser parser; // 只在读线程里用
+
+    std::mutex mu;
+    std::vector<StreamFrame> ring;
+    size_t head, count;
+    bool eof;
+    StreamStats stats_;
+
+    std::atomic<bool> stopping;
+    std::thread reader;
+    const uint64_t frame_interval_ns;
+    uint64_t next_release_ns;
+};
+
+/* =================== 多路流 -> 帧源 =================== */
+/*
+ * 各路轮流取帧，在调用线程里解码（只解没被丢掉的帧）。
+ * 原始帧拷进池子里的 dma-buf 交给 RGA，不做格式转换。
+ */
+class StreamFrameSource : public FrameSource
+{
+public:
+    StreamFrameSource(std::vector<StreamIngest *> streams, const DecodeTarget &target,
+                      StreamSignal &signal, double latency_budget_ms)
+        : streams(streams), target(target), signal(signal),
+          budget_ns((uint64_t)(latency_budget_ms * 1e6)), rr(0)
+    {
+    }
+
+    // 所有流都读完并取空后返回 false
+    bool next(IngestFrame &out) override
+    {
+        for (;;)
+        {
+            // 查队列之前记下 seq，查完到睡下之间来的帧会让 seq 变化
+            uint64_t seen;
+            {
+                std::lock_guard<std::mutex> lock(signal.mu);
+                seen = signal.seq;
+            }
+            bool all_done = true;
+            for (size_t k = 0; k < streams.size(); k++)
+            {
+                const size_t idx = (rr + k) % streams.size();
+                StreamIngest *s = streams[idx];
+                if (s->pop(frame, budget_ns))
+                {
+                    rr = (idx + 1) % streams.size();
+                    out.index = frame.seq;
+                    out.path = s->spec().name.c_str();
+                    out.source = (int)idx;
+                    out.t_capture_ns = frame.t_ns;
+                    out.ok = convert(s->spec(), out) == 0;
+                    if (!out.ok)
+                        printf("%s: frame %ld decode failed\n", out.path, frame.seq);
+                    return true;
+                }
+                if (!s->finished())
+                    all_done = false;
+            }
+            if (all_done)
+                return false;
+
+            TRACE_SPAN("wait_frame");
+            std::unique_lock<std::mutex> lock(signal.mu);
+            signal.cv.wait(lock, [&] { return signal.seq != seen; });
+        }
+    }
+
+private:
+    int convert(const StreamSpec &spec, IngestFrame &out)
+    {
+        if (!spec.raw)
+            return decode_jpeg_image(jpeg, frame.data.data(), frame.data.size(), target, out);
+
+        TRACE_SPAN("raw_copy");
+        const size_t size = frame.data.size();
+        out.buf = dma_pool_cached().acquire(size);
+        if (!out.buf)
+            return -1;
+        {
+            DmaCpuAccess cpu(out.buf, DMA_BUF_SYNC_WRITE);
+            memcpy(out.buf.virt(), frame.data.data(), size);
+        }
+        out.src_width = spec.width;
+        out.src_height = spec.height;
+        out.image = make_image_buffer(out.buf.fd(), out.buf.virt(), spec.width, spec.height,
+                                      spec.format);
+        out.image.yuv_range = spec.yuv_range;
+        return 0;
+    }
+
+    std::vector<StreamIngest *> streams;
+    const DecodeTarget target;
+    StreamSignal &signal;
+    const uint64_t budget_ns;
+    size_t rr; // 下次从哪一路开始找，防止一路饿死别的路
+
+    JpegDecoder jpeg;
+    StreamFrame frame; // 缓冲跟队列来回交换，稳态不分配
+};
+
+#endif
@@ -0,0 +1,85 @@
+/*******************************************************
+ * synth_yolo.h
+ * 合成的 YOLOv8 输出张量（属性 + 数据），kernel_bench 和 host_check 共用，
+ * 不需要板子和录制目录
+ *******************************************************/
+#ifndef SYNTH_YOLO_H
+#define SYNTH_YOLO_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <rknn_api.h>
+
+// 640x640 输入，三个头 80/40/20，NC=80，DFL=16，native NHWC 无填充；
+// density 为通过门限的 cell 比例，命中 cell 的一个类别分数在 0.3~0.9
+struct SynthYolo
+{
+    std::vector<rknn_tensor_attr> attrs;
+    std::vector<std::vector<int8_t> > tensors;
+    std::vector<void *> outputs;
+
+    void build(double density, bool with_sum, unsigned seed)
+    {
+        static const int grids[3] = {80, 40, 20};
+        attrs.clear();
+        tensors.clear();
+        srand(seed);
+        for (int b = 0; b < 3; b++)
+        {
+            const int g = grids[b];
+            const int nt = with_sum ? 3 : 2;
+            size_t base = attrs.size();
+            for (int t = 0; t < nt; t++)
+            {
+                static const int ch[3] = {64, 80, 1};
+                rknn_tensor_attr a;
+                memset(&a, 0, sizeof(a));
+                a.index = attrs.size();
+                a.fmt = RKNN_TENSOR_NHWC;
+                a.type = RKNN_TENSOR_INT8;
+                a.n_dims = 4;
+                a.dims[0] = 1;
+                a.dims[1] = g;
+                a.dims[2] = g;
+                a.dims[3] = ch[t];
+                a.w_stride = g;
+                a.size_with_stride = a.size = g * g * ch[t];
+                a.n_elems = a.size;
+                // box 为 DFL logits；cls / score_sum 为 sigmoid 后的 0~1
+                a.zp = t == 0 ? -60 : -128;
+                a.scale = t == 0 ? 0.09f : 1.0f / 255;
+                attrs.push_back(a);
+                tensors.push_back(std::vector<int8_t>(a.size));
+            }
+
+            int8_t *box = tensors[base].data();
+            int8_t *cls = tensors[base + 1].data();
+            int8_t *sum = with_sum ? tensors[base + 2].data() : NULL;
+            for (int idx = 0; idx < g * g; idx++)
+            {
+                for (int k = 0; k < 64; k++)
+                    box[idx * 64 + k] = (int8_t)(rand() % 160 - 100);
+                // 背景分数 0~0.05
+                for (int c = 0; c < 80; c++)
+                    cls[idx * 80 + c] = (int8_t)(-128 + rand() % 13);
+                float best = 0.02f;
+                if (rand() < density * ((double)RAND_MAX + 1))
+                {
+                    best = 0.3f + 0.6f * rand() / RAND_MAX;
+                    cls[idx * 80 + rand() % 80] = (int8_t)(best * 255 - 128);
+                }
+                if (sum)
+                    sum[idx] = (int8_t)(std::min(best * 255, 255.f) - 128);
+            }
+        }
+        outputs.resize(tensors.size());
+        for (size_t i = 0; i < tensors.size(); i++)
+            outputs[i] = tensors[i].data();
+    }
+};
+
+#endif
@@ -0,0 +1,313 @@
+/*******************************************************
+ * trace.h
+ * 轻量分段计时: TRACE_SPAN("stage") 在作用域结束时记一段，
+ * 每个阶段一个对数分桶直方图（p50/p95/p99/max），
+ * 可选把每段记成事件导出 Chrome / Perfetto trace JSON。
+ *
+ * 每段开销是两次 steady_clock + 几次 relaxed 原子加，约百纳秒，
+ * 相对毫秒级的阶段可以忽略；-DSTAGE_TRACE_DISABLE 时宏（TRACE_SPAN / TRACE_RECORD 等）展开为空。
+ *******************************************************/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TRACE_MAX_STAGES 64
+#define TRACE_HIST_SUB_BITS 4 // 每个 2 的幂区间再分 16 格，分位数相对误差 < 6%
+#define TRACE_HIST_BUCKETS (40 << TRACE_HIST_SUB_BITS)
+
+/* =================== 直方图 =================== */
+// 纳秒值的对数线性分桶，多线程 add 无锁
+class TraceHistogram
+{
+public:
+    TraceHistogram() { reset(); }
+
+    void reset()
+    {
+        count.store(0, std::memory_order_relaxed);
+        sum_ns.store(0, std::memory_order_relaxed);
+        max_ns.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < TRACE_HIST_BUCKETS; i++)
+            bucket[i].store(0, std::memory_order_relaxed);
+    }
+
+    void add(uint64_t ns)
+    {
+        bucket[index(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = max_ns.load(std::memory_order_relaxed);
+        while (ns > m && !max_ns.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t samples() const { return count.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_ns.load(std::memory_order_relaxed); }
+    double mean() const
+    {
+        uint64_t n = samples();
+        return n ? (double)sum_ns.load(std::memory_order_relaxed) / n : 0;
+    }
+
+    // p 取 0~1，返回所在桶的中点（纳秒），不超过 max
+    double percentile(double p) const
+    {
+        uint64_t n = samples();
+        if (!n)
+            return 0;
+        uint64_t rank = (uint64_t)(p * (n - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < TRACE_HIST_BUCKETS; i++)
+        {
+            seen += bucket[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                double mid = (lower(i) + lower(i + 1)) * 0.5;
+                return mid < (double)max() ? mid : (double)max();
+            }
+        }
+        return (double)max();
+    }
+
+private:
+    static const int SUB = 1 << TRACE_HIST_SUB_BITS;
+
+    // [0, SUB) 逐纳秒；之后每个 [2^e, 2^(e+1)) 分 SUB 格
+    static int index(uint64_t ns)
+    {
+        if (ns < (uint64_t)SUB)
+            return (int)ns;
+        int e = 63 - __builtin_clzll(ns);
+        int sub = (int)(ns >> (e - TRACE_HIST_SUB_BITS)) & (SUB - 1);
+        int i = (e - TRACE_HIST_SUB_BITS + 1) * SUB + sub;
+        return i < TRACE_HIST_BUCKETS ? i : TRACE_HIST_BUCKETS - 1;
+    }
+
+    static double lower(int i)
+    {
+        if (i < SUB)
+            return i;
+        int e = i / SUB + TRACE_HIST_SUB_BITS - 1;
+        int sub = i % SUB;
+        return (double)((uint64_t)(SUB + sub) << (e - TRACE_HIST_SUB_BITS));
+    }
+
+    std::atomic<uint64_t> count, sum_ns, max_ns;
+    std::atomic<uint32_t> bucket[TRACE_HIST_BUCKETS];
+};
+
+/* =================== Tracer =================== */
+class Tracer
+{
+public:
+    Tracer() : nstages(0), next_event(0), dropped(0), origin(now_ns()) {}
+
+    static uint64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // 同名阶段合并成一个直方图；每个 TRACE_SPAN 位置只在第一次经过时调用
+    int stage(const char *name)
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        for (int i = 0; i < nstages; i++)
+            if (strcmp(names[i], name) == 0)
+                return i;
+        if (nstages == TRACE_MAX_STAGES)
+            return TRACE_MAX_STAGES - 1;
+        names[nstages] = name;
+        return nstages++;
+    }
+
+    /*
+     * 打开事件记录，最多记 capacity 段，超出的只进直方图不进事件。
+     * 须在被测代码开始前调用；不调用时只有直方图。
+     */
+    void enable_events(size_t capacity)
+    {
+        events.resize(capacity);
+        next_event.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+    }
+
+    void record(int id, uint64_t t0, uint64_t t1)
+    {
+        hist[id].add(t1 - t0);
+        if (events.empty())
+            return;
+        size_t k = next_event.fetch_add(1, std::memory_order_relaxed);
+        if (k >= events.size())
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        TraceEvent &ev = events[k];
+        ev.stage = id;
+        ev.tid = thread_index();
+        ev.t0 = t0;
+        ev.dur = t1 - t0;
+    }
+
+    // 当前线程在 trace 里的显示名，比如 Pipeline 的 npu / post 线程
+    void set_thread_name(const char *name)
+    {
+        int tid = thread_index();
+        std::lock_guard<std::mutex> lock(mu);
+        if ((int)thread_names.size() <= tid)
+            thread_names.resize(tid + 1);
+        thread_names[tid] = name;
+    }
+
+    const TraceHistogram &histogram(int id) const { return hist[id]; }
+
+    void print_stats(FILE *fp = stdout) const
+    {
+        fprintf(fp, "%-16s %8s %9s %9s %9s %9s %9s\n",
+                "stage(ms)", "count", "mean", "p50", "p95", "p99", "max");
+        for (int i = 0; i < nstages; i++)
+        {
+            const TraceHistogram &h = hist[i];
+            if (!h.samples())
+                continue;
+            fprintf(fp, "%-16s %8llu %9.3f %9.3f %9.3f %9.3f %9.3f\n", names[i],
+                    (unsigned long long)h.samples(), h.mean() / 1e6, h.percentile(0.50) / 1e6,
+                    h.percentile(0.95) / 1e6, h.percentile(0.99) / 1e6, h.max() / 1e6);
+        }
+    }
+
+    // Chrome / Perfetto 可直接打开的 JSON（"X" 完整事件，时间单位微秒）
+    int write_chrome_trace(const char *path) const
+    {
+        FILE *fp = fopen(path, "w");
+        if (!fp)
+        {
+            printf("open %s failed\n", path);
+            return -1;
+        }
+        size_t n = next_event.load(std::memory_order_relaxed);
+        if (n > events.size())
+            n = events.size();
+
+        fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        bool first = true;
+        for (size_t t = 0; t < thread_names.size(); t++)
+        {
+            if (thread_names[t].empty())
+                continue;
+            fprintf(fp, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %zu, "
+                        "\"args\": {\"name\": \"%s\"}}",
+                    first ? "" : ",\n", t, thread_names[t].c_str());
+            first = false;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            const TraceEvent &ev = events[i];
+            fprintf(fp, "%s{\"name\": \"%s\", \"cat\": \"stage\", \"ph\": \"X\", \"pid\": 1, "
+                        "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    first ? "" : ",\n", names[ev.stage], ev.tid,
+                    (double)(ev.t0 - origin) / 1e3, (double)ev.dur / 1e3);
+            first = false;
+        }
+        fprintf(fp, "\n]}\n");
+        fclose(fp);
+
+        size_t lost = dropped.load(std::memory_order_relaxed);
+        printf("trace: %zu events -> %s", n, path);
+        if (lost)
+            printf(" (%zu dropped, capacity %zu)", lost, events.size());
+        printf("\n");
+        return 0;
+    }
+
+private:
+    struct TraceEvent
+    {
+        int stage;
+        int tid;
+        uint64_t t0, dur;
+    };
+
+    // 线程第一次记录时分配的小整数编号，trace 里当 tid 用
+    static int thread_index()
+    {
+        static std::atomic<int> next(0);
+        thread_local int idx = next.fetch_add(1, std::memory_order_relaxed);
+        return idx;
+    }
+
+    std::mutex mu;
+    const char *names[TRACE_MAX_STAGES];
+    int nstages;
+    TraceHistogram hist[TRACE_MAX_STAGES];
+
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> next_event, dropped;
+    std::vector<std::string> thread_names;
+    uint64_t origin;
+};
+
+inline Tracer &tracer()
+{
+    static Tracer t;
+    return t;
+}
+
+// 作用域计时，析构时记一段
+class TraceSpan
+{
+public:
+    explicit TraceSpan(int id) : id(id), t0(Tracer::now_ns()) {}
+    ~TraceSpan() { tracer().record(id, t0, Tracer::now_ns()); }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    int id;
+    uint64_t t0;
+};
+
+/* =================== 宏 =================== */
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifndef STAGE_TRACE_DISABLE
+#define TRACE_SPAN(name)                                                             \
+    static const int TRACE_CONCAT(trace_id_, __LINE__) = tracer().stage(name);      \
+    TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(TRACE_CONCAT(trace_id_, __LINE__))
+#define TRACE_THREAD_NAME(name) tracer().set_thread_name(name)
+// 起止时刻不在同一作用域的段（如帧到齐 -> 出结果），t0 / t1 为 Tracer::now_ns
+#define TRACE_RECORD(name, t0, t1)                                                   \
+    do                                                                               \
+    {                                                                                \
+        static const int TRACE_CONCAT(trace_id_, __LINE__) = tracer().stage(name);  \
+        tracer().record(TRACE_CONCAT(trace_id_, __LINE__), t0, t1);                  \
+    } while (0)
+#else
+#define TRACE_SPAN(name) \
+    do                   \
+    {                    \
+    } while (0)
+#define TRACE_THREAD_NAME(name) \
+    do                          \
+    {                           \
+    } while (0)
+#define TRACE_RECORD(name, t0, t1) \
+    do                             \
+    {                              \
+    } while (0)
+#endif
+
+#endif
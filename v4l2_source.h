@@ -0,0 +1,378 @@
+/*******************************************************
+ * v4l2_source.h
+ * V4L2 摄像头帧源: ISP / UVC 的 NV12 / YUYV 帧用 VIDIOC_EXPBUF 导出成 dma-buf，
+ * 启动时每块缓冲经 import_dma_frame 校验一次，之后直接交给 letterbox / 缩放 / CSC，
+ * CPU 不映射、不拷贝像素。
+ *
+ * 缓冲用完才还给驱动: next() 交出的帧在下一次 next() 时重新 QBUF，
+ * 调用方在两次 next 之间必须做完 RGA（preprocess 同步返回即满足）。
+ * 一次取帧时驱动里已攒了多帧，只交最新的，旧的直接还回去，延迟不随积压增长。
+ *******************************************************/
+#ifndef V4L2_SOURCE_H
+#define V4L2_SOURCE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+#include <string>
+#include <vector>
+
+#include "frame_ingest.h"
+#include "trace.h"
+
+#define V4L2_SOURCE_BUFFERS 4
+#define V4L2_SOURCE_TIMEOUT_MS 2000 // 这么久没有帧就当摄像头停了
+
+/* =================== 参数 =================== */
+// DEV:FMT:WxH，FMT 为 nv12 / yuyv，例如 /dev/video0:nv12:1920x1080
+struct CameraSpec
+{
+    std::string dev;
+    int format; // PixelFormat
+    int width, height;
+};
+
+// 成功返回 0
+static inline int parse_camera_spec(const char *spec, CameraSpec *out)
+{
+    const char *colon = strchr(spec, ':');
+    char fmt[16];
+    if (!colon || colon == spec ||
+        sscanf(colon + 1, "%15[^:]:%dx%d", fmt, &out->width, &out->height) != 3)
+    {
+        printf("bad camera spec %s (want DEV:FMT:WxH)\n", spec);
+        return -1;
+    }
+    out->dev.assign(spec, colon - spec);
+    out->format = strcmp(fmt, "nv12") == 0 ? PIXEL_NV12 : strcmp(fmt, "yuyv") == 0 ? PIXEL_YUYV : -1;
+    if (out->format < 0 || out->width <= 0 || out->height <= 0 || ((out->width | out->height) & 1))
+    {
+        printf("bad camera format %s %dx%d (nv12 / yuyv, even size)\n", fmt, out->width,
+               out->height);
+        return -1;
+    }
+    return 0;
+}
+
+/* =================== 帧源 =================== */
+struct V4l2SourceStats
+{
+    long delivered; // 交给推理的
+    long dropped;   // 取帧时已有更新的一帧，直接还给驱动的
+};
+
+class V4l2FrameSource : public FrameSource
+{
+public:
+    // max_frames > 0 时交出这么多帧后结束
+    V4l2FrameSource(const CameraSpec &spec, long max_frames)
+        : spec(spec), max_frames(max_frames), fd(-1), mplane(false), streaming(false),
+          held(-1)
+    {
+        memset(&stats_, 0, sizeof(stats_));
+        memset(&desc, 0, sizeof(desc));
+    }
+
+    ~V4l2FrameSource()
+    {
+        if (streaming)
+        {
+            int type = buf_type();
+            ioctl(fd, VIDIOC_STREAMOFF, &type);
+        }
+        for (size_t i = 0; i < buf_fds.size(); i++)
+            if (buf_fds[i] >= 0)
+                close(buf_fds[i]);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    V4l2FrameSource(const V4l2FrameSource &) = delete;
+    V4l2FrameSource &operator=(const V4l2FrameSource &) = delete;
+
+    // 打开设备、设格式、导出缓冲并开始采集；成功返回 0
+    int start()
+    {
+        fd = ::open(spec.dev.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+        {
+            printf("open %s failed: %s\n", spec.dev.c_str(), strerror(errno));
+            return -1;
+        }
+
+        struct v4l2_capability cap;
+        memset(&cap, 0, sizeof(cap));
+        if (xioctl(VIDIOC_QUERYCAP, &cap, "VIDIOC_QUERYCAP") != 0)
+            return -1;
+        const uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps
+                                                                        : cap.capabilities;
+        // RV1106 的 rkisp 是多平面接口，UVC 摄像头是单平面
+        mplane = (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE) != 0;
+        if ((!mplane && !(caps & V4L2_CAP_VIDEO_CAPTURE)) || !(caps & V4L2_CAP_STREAMING))
+        {
+            printf("%s: not a streaming capture device\n", spec.dev.c_str());
+            return -1;
+        }
+
+        if (set_format() != 0 || export_buffers() != 0)
+            return -1;
+
+        int type = buf_type();
+        if (xioctl(VIDIOC_STREAMON, &type, "VIDIOC_STREAMON") != 0)
+            return -1;
+        streaming = true;
+        return 0;
+    }
+
+    bool next(IngestFrame &out) override
+    {
+        // 上一帧的 RGA 早已完成，缓冲还给驱动
+        if (held >= 0)
+        {
+            queue(held);
+            held = -1;
+        }
+        if (max_frames > 0 && stats_.delivered >= max_frames)
+            return false;
+
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+        {
+            TRACE_SPAN("wait_frame");
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            int ret;
+            do
+                ret = poll(&pfd, 1, V4L2_SOURCE_TIMEOUT_MS);
+            while (ret < 0 && errno == EINTR);
+            if (ret <= 0)
+            {
+                printf("%s: no frame in %d ms\n", spec.dev.c_str(), V4L2_SOURCE_TIMEOUT_MS);
+                return false;
+            }
+            if (dequeue(&buf, &plane) != 0)
+                return false;
+        }
+        // 驱动里还有更新的帧就换成最新的
+        struct v4l2_buffer newer;
+        struct v4l2_plane newer_plane;
+        while (dequeue(&newer, &newer_plane) == 0)
+        {
+            queue(buf.index);
+            stats_.dropped++;
+            buf = newer;
+            plane = newer_plane;
+            if (mplane)
+                buf.m.planes = &plane;
+        }
+
+        held = buf.index;
+        out.index = buf.sequence;
+        out.path = spec.dev.c_str();
+        // 驱动时间戳是 CLOCK_MONOTONIC，和 steady_clock（Tracer::now_ns）同一时钟
+        if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+            out.t_capture_ns = (uint64_t)buf.timestamp.tv_sec * 1000000000ull +
+                               (uint64_t)buf.timestamp.tv_usec * 1000;
+        else
+            out.t_capture_ns = Tracer::now_ns();
+        // 启动时校验好的描述，每帧不再 lseek
+        out.buf.reset();
+        out.source = 0;
+        out.src_width = desc.width;
+        out.src_height = desc.height;
+        out.image = images[buf.index];
+        out.ok = true;
+        stats_.delivered++;
+        return true;
+    }
+
+    const V4l2SourceStats &stats() const { return stats_; }
+
+    void print_stats() const
+    {
+        printf("camera %s: %dx%d stride %d, %zu dma-bufs, delivered %ld, dropped %ld\n",
+               spec.dev.c_str(), desc.width, desc.height, desc.stride, buf_fds.size(),
+               stats_.delivered, stats_.dropped);
+    }
+
+private:
+    int buf_type() const
+    {
+        return mplane ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE : V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    }
+
+    int xioctl(unsigned long req, void *arg, const char *name)
+    {
+        int ret;
+        do
+            ret = ioctl(fd, req, arg);
+        while (ret < 0 && errno == EINTR);
+        if (ret < 0)
+            printf("%s: %s failed: %s\n", spec.dev.c_str(), name, strerror(errno));
+        return ret < 0 ? -1 : 0;
+    }
+
+    // 驱动可以改尺寸（按实际值走），改格式或要求多个平面不行
+    int set_format()
+    {
+        const uint32_t fourcc = spec.format == PIXEL_NV12 ? V4L2_PIX_FMT_NV12 : V4L2_PIX_FMT_YUYV;
+        struct v4l2_format f;
+        memset(&f, 0, sizeof(f));
+        f.type = buf_type();
+        if (mplane)
+        {
+            f.fmt.pix_mp.width = spec.width;
+            f.fmt.pix_mp.height = spec.height;
+            f.fmt.pix_mp.pixelformat = fourcc;
+            f.fmt.pix_mp.field = V4L2_FIELD_NONE;
+            f.fmt.pix_mp.num_planes = 1;
+        }
+        else
+        {
+            f.fmt.pix.width = spec.width;
+            f.fmt.pix.height = spec.height;
+            f.fmt.pix.pixelformat = fourcc;
+            f.fmt.pix.field = V4L2_FIELD_NONE;
+        }
+        if (xioctl(VIDIOC_S_FMT, &f, "VIDIOC_S_FMT") != 0)
+            return -1;
+
+        uint32_t got_fourcc, quant;
+        if (mplane)
+        {
+            if (f.fmt.pix_mp.num_planes != 1)
+            {
+                printf("%s: %d-plane layout not supported\n", spec.dev.c_str(),
+                       f.fmt.pix_mp.num_planes);
+                return -1;
+            }
+            got_fourcc = f.fmt.pix_mp.pixelformat;
+            desc.width = f.fmt.pix_mp.width;
+            desc.height = f.fmt.pix_mp.height;
+            desc.stride = f.fmt.pix_mp.plane_fmt[0].bytesperline;
+            quant = f.fmt.pix_mp.quantization;
+        }
+        else
+        {
+            got_fourcc = f.fmt.pix.pixelformat;
+            desc.width = f.fmt.pix.width;
+            desc.height = f.fmt.pix.height;
+            desc.stride = f.fmt.pix.bytesperline;
+            quant = f.fmt.pix.quantization;
+        }
+        if (got_fourcc != fourcc)
+        {
+            printf("%s: driver does not support the requested pixel format\n", spec.dev.c_str());
+            return -1;
+        }
+        if (desc.width != spec.width || desc.height != spec.height)
+            printf("%s: driver picked %dx%d\n", spec.dev.c_str(), desc.width, desc.height);
+        // V4L2 的 YUV 默认就是有限范围，驱动明说全范围才按全范围
+        desc.format = spec.format;
+        desc.vstride = 0;
+        desc.yuv_range = quant == V4L2_QUANTIZATION_FULL_RANGE ? YUV_RANGE_FULL : YUV_RANGE_LIMITED;
+        return 0;
+    }
+
+    // 申请 MMAP 缓冲、逐个导出成 dma-buf 并入队；CPU 侧不映射
+    int export_buffers()
+    {
+        struct v4l2_requestbuffers req;
+        memset(&req, 0, sizeof(req));
+        req.count = V4L2_SOURCE_BUFFERS;
+        req.type = buf_type();
+        req.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(VIDIOC_REQBUFS, &req, "VIDIOC_REQBUFS") != 0)
+            return -1;
+        if (req.count < 2)
+        {
+            printf("%s: only %u buffers\n", spec.dev.c_str(), req.count);
+            return -1;
+        }
+
+        buf_fds.assign(req.count, -1);
+        images.resize(req.count);
+        for (uint32_t i = 0; i < req.count; i++)
+        {
+            struct v4l2_exportbuffer exp;
+            memset(&exp, 0, sizeof(exp));
+            exp.type = buf_type();
+            exp.index = i;
+            exp.plane = 0;
+            exp.flags = O_RDONLY | O_CLOEXEC;
+            if (xioctl(VIDIOC_EXPBUF, &exp, "VIDIOC_EXPBUF") != 0)
+                return -1;
+            buf_fds[i] = exp.fd;
+
+            // 布局和 dma-buf 大小只在这里校验一次，结果按缓冲下标留着
+            desc.fd = exp.fd;
+            if (import_dma_frame(desc, &images[i]) != 0)
+                return -1;
+            if (queue(i) != 0)
+                return -1;
+        }
+        return 0;
+    }
+
+    int queue(uint32_t index)
+    {
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+        memset(&buf, 0, sizeof(buf));
+        memset(&plane, 0, sizeof(plane));
+        buf.type = buf_type();
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = index;
+        if (mplane)
+        {
+            buf.m.planes = &plane;
+            buf.length = 1;
+        }
+        return xioctl(VIDIOC_QBUF, &buf, "VIDIOC_QBUF");
+    }
+
+    // 非阻塞取一帧；没有现成的帧返回 -1（不打印）
+    int dequeue(struct v4l2_buffer *buf, struct v4l2_plane *plane)
+    {
+        memset(buf, 0, sizeof(*buf));
+        memset(plane, 0, sizeof(*plane));
+        buf->type = buf_type();
+        buf->memory = V4L2_MEMORY_MMAP;
+        if (mplane)
+        {
+            buf->m.planes = plane;
+            buf->length = 1;
+        }
+        int ret;
+        do
+            ret = ioctl(fd, VIDIOC_DQBUF, buf);
+        while (ret < 0 && errno == EINTR);
+        if (ret < 0)
+        {
+            if (errno != EAGAIN)
+                printf("%s: VIDIOC_DQBUF failed: %s\n", spec.dev.c_str(), strerror(errno));
+            return -1;
+        }
+        return 0;
+    }
+
+    const CameraSpec spec;
+    const long max_frames;
+    int fd;
+    bool mplane;
+    bool streaming;
+    std::vector<int> buf_fds;         // 按 V4L2 缓冲下标
+    std::vector<ImageBuffer> images;  // 同上，校验过的 fd-only 图像
+    DmaFrameDesc desc;                // 格式 / 尺寸 / 行跨度，fd 为最后导出的那块
+    int held;                 // 交出去还没还的缓冲下标
+    V4l2SourceStats stats_;
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*******************************************************
+ * yolov8_detector.h
+ * 常驻 YOLOv8 检测器: 引擎 + 解码计划 + 候选/NMS 缓冲都只建一次，
+ * detect(frame) 每帧只做 letterbox + rknn_run + 后处理；
+ * preprocess / postprocess 按引擎的 slot 分开，可交给 Pipeline 分线程跑
+ *******************************************************/
+#ifndef YOLOV8_DETECTOR_H
+#define YOLOV8_DETECTOR_H
+
+#include <stdio.h>
+#include <vector>
+#include <chrono>
+
+#include "infer.h"
+#include "preprocess.h"
+#include "yolov8_postprocess.h"
+#include "trace.h"
+
+struct DetectorStats
+{
+    long frames;
+    double preprocess_ms, run_ms, post_ms; // 累计
+};
+
+class YoloDetector
+{
+public:
+    YoloDetector(Infer &infer, ImageOps &ops, float conf_thresh, float nms_thresh, int max_det)
+        : infer(infer), ops(ops), conf_thresh(conf_thresh), nms_engine(nms_thresh, max_det)
+    {
+        memset(&stats_, 0, sizeof(stats_));
+    }
+
+    /*
+     * 按引擎缓存的输出属性编译解码计划、预留候选和 NMS 缓冲；成功返回 0。
+     * 需要多 slot 时先 infer.create_slots(n) 再 init。
+     */
+    int init()
+    {
+        if (plan.compile(infer.output_native_attrs(), infer.output_num(),
+                         infer.model_width(), infer.model_height(), conf_thresh) != 0)
+        {
+            printf("unsupported yolov8 outputs\n");
+            return -1;
+        }
+        cand.reserve(plan.capacity());
+        nms_engine.reserve(plan.capacity(), plan.num_classes);
+
+        const rknn_tensor_attr &in = infer.input_attr();
+        slots.resize(infer.num_slots());
+        for (int i = 0; i < infer.num_slots(); i++)
+        {
+            SlotState &st = slots[i];
+            st.input = make_image_buffer(infer.input_mem(i)->fd, infer.input_mem(i)->virt_addr,
+                                         infer.model_width(), infer.model_height(),
+                                         PIXEL_RGB888, in.w_stride);
+            // 没经过 preprocess（比如回放）时框保持模型坐标
+            st.lb = letterbox_info(infer.model_width(), infer.model_height(),
+                                   infer.model_width(), infer.model_height());
+            st.frame_w = infer.model_width();
+            st.frame_h = infer.model_height();
+        }
+        return 0;
+    }
+
+    /*
+     * 一帧: frame letterbox 进输入张量 -> rknn_run -> 解码 + NMS。
+     * boxes 为 frame 坐标系（已去掉 letterbox 的缩放和边带），按分数降序；
+     * 容量够时不分配。
+     */
+    int detect(const ImageBuffer &frame, std::vector<Box> &boxes)
+    {
+        if (preprocess(frame) != 0)
+            return -1;
+
+        if (run() != 0)
+            return -1;
+
+        postprocess(boxes);
+        return 0;
+    }
+
+    // detect 拆开的三步，slot 对应 infer 的 io mem；三步可以在不同线程。
+    // frame 可以是只有 fd 的外部 dma-buf（import_dma_frame），返回后就不再引用它
+    int preprocess(const ImageBuffer &frame, int slot = 0)
+    {
+        TRACE_SPAN("letterbox");
+        auto t0 = std::chrono::steady_clock::now();
+        SlotState &st = slots[slot];
+        st.frame_w = frame.width;
+        st.frame_h = frame.height;
+        // 缩放结果直接写进该 slot 的输入张量内存（按 native w_stride），边带由 ops 填充
+        int ret = letterbox_into(ops, frame, st.input, &st.lb);
+        stats_.preprocess_ms += ms_since(t0);
+        if (ret != 0)
+            printf("letterbox into input failed\n");
+        return ret;
+    }
+
+    // 候选和 NMS 缓冲只有一份，同一时刻只能有一个线程调用
+    void postprocess(std::vector<Box> &boxes, int slot = 0)
+    {
+        TRACE_SPAN("postprocess");
+        auto t0 = std::chrono::steady_clock::now();
+        const SlotState &st = slots[slot];
+        cand.clear();
+        {
+            TRACE_SPAN("decode");
+            yolo_decode(plan, infer.outputs(slot), cand);
+        }
+        {
+            TRACE_SPAN("nms");
+            yolo_nms(nms_engine, cand);
+        }
+
+        boxes.clear();
+        const float inv = st.lb.scale > 0 ? 1.0f / st.lb.scale : 1.0f;
+        for (int k = 0; k < cand.nkeep; k++)
+        {
+            Box b = cand.box(k);
+            b.x1 = clampf((b.x1 - st.lb.pad_x) * inv, st.frame_w);
+            b.y1 = clampf((b.y1 - st.lb.pad_y) * inv, st.frame_h);
+            b.x2 = clampf((b.x2 - st.lb.pad_x) * inv, st.frame_w);
+            b.y2 = clampf((b.y2 - st.lb.pad_y) * inv, st.frame_h);
+            boxes.push_back(b);
+        }
+        stats_.post_ms += ms_since(t0);
+        stats_.frames++;
+    }
+
+    // 流水线里 NPU 阶段走这里，detect 的 run 耗时也记在同一处
+    int run(int slot = 0)
+    {
+        TRACE_SPAN("npu_run");
+        auto t0 = std::chrono::steady_clock::now();
+        int ret = infer.run(slot);
+        stats_.run_ms += ms_since(t0);
+        return ret;
+    }
+
+    int num_classes() const { return plan.num_classes; }
+    int capacity() const { return plan.capacity(); }
+    const LetterboxInfo &letterbox(int slot = 0) const { return slots[slot].lb; }
+    const DetectorStats &stats() const { return stats_; }
+
+    void print_stats() const
+    {
+        long n = stats_.frames ? stats_.frames : 1;
+        printf("detector: %ld frames, avg preprocess %.3f ms, run %.3f ms, post %.3f ms\n",
+               stats_.frames, stats_.preprocess_ms / n, stats_.run_ms / n, stats_.post_ms / n);
+    }
+
+private:
+    static double ms_since(std::chrono::steady_clock::time_point t0)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0)
+            .count();
+    }
+
+    static float clampf(float v, int hi)
+    {
+        return v < 0 ? 0 : (v > hi ? (float)hi : v);
+    }
+
+    Infer &infer;
+    ImageOps &ops;
+    float conf_thresh;
+
+    YoloDecodePlan plan;
+    YoloCandidates cand;
+    NmsEngine nms_engine;
+
+    // 每个 slot 的输入张量描述和这一帧的 letterbox 参数
+    struct SlotState
+    {
+        ImageBuffer input;
+        LetterboxInfo lb;
+        int frame_w, frame_h;
+    };
+    std::vector<SlotState> slots;
+
+    DetectorStats stats_;
+};
+
+#endif
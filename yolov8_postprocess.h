@@ -0,0 +1,402 @@
+/*******************************************************
+ * yolov8_postprocess.h
+ * RV1106 YOLOv8 INT8 NHWC 后处理: DFL / 解码 / NMS
+ *******************************************************/
+#ifndef YOLOV8_POSTPROCESS_H
+#define YOLOV8_POSTPROCESS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "rknn_api.h"
+#include "int8_kernels.h"
+#include "nms_engine.h"
+
+
+/* =================== Box =================== */
+struct Box
+{
+    float x1, y1, x2, y2, score;
+    int cls;
+};
+
+/* =================== 候选 SoA =================== */
+// 逐帧候选框的列存储，容量按模型 grid 总数一次定好，逐帧只 clear 不分配。
+// 解码直接写列，NMS 结果以 keep 下标的形式留在同一个存储里。
+struct YoloCandidates
+{
+    std::vector<float> x1, y1, x2, y2, score;
+    std::vector<int> cls;
+    std::vector<int> keep; // NMS 保留的候选下标，分数降序
+    std::vector<int32_t> cells; // 单个分支通过 score_sum 预筛的 cell 下标
+    int count = 0;
+    int nkeep = 0;
+
+    void reserve(int capacity)
+    {
+        x1.resize(capacity);
+        y1.resize(capacity);
+        x2.resize(capacity);
+        y2.resize(capacity);
+        score.resize(capacity);
+        cls.resize(capacity);
+        keep.resize(capacity);
+        cells.resize(capacity);
+        clear();
+    }
+
+    void clear()
+    {
+        count = 0;
+        nkeep = 0;
+    }
+
+    // 第 k 个 NMS 结果
+    Box box(int k) const
+    {
+        int i = keep[k];
+        Box b;
+        b.x1 = x1[i];
+        b.y1 = y1[i];
+        b.x2 = x2[i];
+        b.y2 = y2[i];
+        b.score = score[i];
+        b.cls = cls[i];
+        return b;
+    }
+};
+
+/* =================== 量化门限 =================== */
+// 满足 (q - zp) * scale >= thresh 的最小量化值，逐值套用解码时同一个
+// 反量化表达式，保证量化域判定和浮点判定逐位一致；没有满足的返回 128
+static inline int quant_min_q(const rknn_tensor_attr &attr, float thresh)
+{
+    for (int q = -128; q <= 127; q++)
+        if ((q - attr.zp) * attr.scale >= thresh)
+            return q;
+    return 128;
+}
+
+/* =================== DFL =================== */
+// box 张量的 exp 查找表: exp_q[q + 128] = expf((q - zp) * scale)
+struct DflTable
+{
+    float exp_q[256];
+
+    void init(const rknn_tensor_attr &attr)
+    {
+        for (int q = -128; q <= 127; q++)
+            exp_q[q + 128] = expf((q - attr.zp) * attr.scale);
+    }
+};
+
+// 直接在 int8 上做 DFL 期望: 没有反量化，也没有 expf，只剩查表和乘加。
+// DL > 0 时 bin 数是编译期常量，dl 参数被忽略；有 NEON / SSE2 时 4 条边各占
+// 一个 lane，每个 bin 查 4 次表拼成一个向量，4 条边的累加和除法一起做。
+template <int DL>
+static inline void compute_dfl(const int8_t *src, const DflTable &t, int dl, float *dst)
+{
+#if defined(INT8_KERNELS_NEON) || defined(INT8_KERNELS_SSE2)
+    if (DL > 0)
+    {
+        const float *e = t.exp_q + 128;
+#if defined(INT8_KERNELS_NEON)
+        float32x4_t sum = vdupq_n_f32(0.f), acc = sum, idx = sum;
+        const float32x4_t one = vdupq_n_f32(1.f);
+        for (int i = 0; i < DL; i++)
+        {
+            float32x4_t v = vdupq_n_f32(e[src[i]]);
+            v = vsetq_lane_f32(e[src[DL + i]], v, 1);
+            v = vsetq_lane_f32(e[src[2 * DL + i]], v, 2);
+            v = vsetq_lane_f32(e[src[3 * DL + i]], v, 3);
+            sum = vaddq_f32(sum, v);
+            acc = vmlaq_f32(acc, v, idx);
+            idx = vaddq_f32(idx, one);
+        }
+        // ARMv7 没有向量除法，倒数估计又会改变结果，4 个除法留给标量
+        float s[4];
+        vst1q_f32(s, sum);
+        vst1q_f32(dst, acc);
+        for (int b = 0; b < 4; b++)
+            dst[b] /= s[b];
+#else
+        __m128 sum = _mm_setzero_ps(), acc = sum, idx = sum;
+        const __m128 one = _mm_set1_ps(1.f);
+        for (int i = 0; i < DL; i++)
+        {
+            __m128 v = _mm_setr_ps(e[src[i]], e[src[DL + i]], e[src[2 * DL + i]], e[src[3 * DL + i]]);
+            sum = _mm_add_ps(sum, v);
+            acc = _mm_add_ps(acc, _mm_mul_ps(v, idx));
+            idx = _mm_add_ps(idx, one);
+        }
+        _mm_storeu_ps(dst, _mm_div_ps(acc, sum));
+#endif
+        return;
+    }
+#endif
+
+    const int n = DL > 0 ? DL : dl;
+    for (int b = 0; b < 4; b++)
+    {
+        const int8_t *p = src + b * n;
+        float sum = 0.f, acc = 0.f;
+        for (int i = 0; i < n; i++)
+        {
+            float v = t.exp_q[p[i] + 128];
+            sum += v;
+            acc += v * i;
+        }
+        dst[b] = acc / sum;
+    }
+}
+
+/* =================== 解码计划 =================== */
+// 一个检测头 (box, cls, 可选 score_sum) 的解码计划，init 阶段按查询到的
+// native NHWC 属性编译一次，逐帧只读。
+struct YoloBranchPlan;
+typedef void (*YoloBranchKernel)(const YoloBranchPlan &br, void *const *outputs,
+                                 YoloCandidates &out);
+
+// native NHWC 张量里一个 cell / 一行的字节跨度（含 w_stride 和通道对齐）
+struct NhwcLayout
+{
+    int h, w, c;
+    int cell, row;
+
+    int init(const rknn_tensor_attr &attr)
+    {
+        if (attr.fmt != RKNN_TENSOR_NHWC || attr.n_dims != 4)
+            return -1;
+        h = attr.dims[1];
+        w = attr.dims[2];
+        c = attr.dims[3];
+        int ws = (attr.w_stride >= (uint32_t)w) ? (int)attr.w_stride : w;
+        uint32_t sz = attr.size_with_stride ? attr.size_with_stride : attr.size;
+        cell = c;
+        if (sz % (uint32_t)(h * ws) == 0 && (int)(sz / (h * ws)) >= c)
+            cell = sz / (h * ws);
+        row = ws * cell;
+        return 0;
+    }
+
+    int offset(int y, int x) const { return y * row + x * cell; }
+};
+
+struct YoloBranchPlan
+{
+    int box_out, cls_out, sum_out; // 输出张量下标，sum_out = -1 表示没有 score_sum
+    int gh, gw, stride;
+    int num_classes, dfl_len;
+    NhwcLayout box_l, cls_l, sum_l;
+
+    int8_t sum_th;  // score_sum 张量门限
+    int cls_min_q;  // 类别分数量化门限，> 127 表示全部拒绝
+    int32_t cls_zp;
+    float cls_scale;
+    DflTable dfl;
+
+    YoloBranchKernel kernel;
+};
+
+/* =================== 后处理 RV1106 =================== */
+// 把 score_sum 通过门限的 cell 下标 (y * gw + x) 写进 cells
+static inline int prefilter_cells(const int8_t *sum, const YoloBranchPlan &br, int32_t *cells)
+{
+    const int gh = br.gh, gw = br.gw;
+    int n = 0;
+    if (!sum)
+    {
+        for (int idx = 0; idx < gh * gw; idx++)
+            cells[idx] = idx;
+        return gh * gw;
+    }
+    if (br.sum_l.cell == 1 && br.sum_l.row == gw)
+        return compact_ge_s8(sum, gh * gw, br.sum_th, cells);
+
+    for (int y = 0; y < gh; y++)
+    {
+        const int8_t *row = sum + y * br.sum_l.row;
+        if (br.sum_l.cell == 1)
+        {
+            // 只有行尾对齐: 逐行压缩再补上行偏移
+            int k = compact_ge_s8(row, gw, br.sum_th, cells + n);
+            for (int i = n; i < n + k; i++)
+                cells[i] += y * gw;
+            n += k;
+        }
+        else
+        {
+            for (int x = 0; x < gw; x++)
+                if (row[x * br.sum_l.cell] >= br.sum_th)
+                    cells[n++] = y * gw + x;
+        }
+    }
+    return n;
+}
+
+// NC / DL 为 0 时走运行期的类别数和 bin 数，否则是编译期常量
+template <int NC, int DL>
+static void process_branch(const YoloBranchPlan &br, void *const *outputs,
+                           YoloCandidates &out)
+{
+    const int8_t *box = (const int8_t *)outputs[br.box_out];
+    const int8_t *cls = (const int8_t *)outputs[br.cls_out];
+    const int8_t *sum = br.sum_out >= 0 ? (const int8_t *)outputs[br.sum_out] : NULL;
+    const int nc = NC > 0 ? NC : br.num_classes;
+    const int gw = br.gw, stride = br.stride;
+
+    // 先用 score_sum 整张量筛出候选 cell，类别 argmax 和 DFL 只在稀疏列表上做
+    int32_t *cells = out.cells.data();
+    int ncell = prefilter_cells(sum, br, cells);
+
+    for (int n = 0; n < ncell; n++)
+    {
+        int idx = cells[n];
+        int i = idx / gw;
+        int j = idx - i * gw;
+
+        int8_t best_q;
+        int best = argmax_s8(cls + br.cls_l.offset(i, j), nc, br.cls_min_q, &best_q);
+        if (best < 0)
+            continue;
+
+        float score = (best_q - br.cls_zp) * br.cls_scale;
+
+        float dist[4];
+        compute_dfl<DL>(box + br.box_l.offset(i, j), br.dfl, br.dfl_len, dist);
+
+        float cx = (j + 0.5f) * stride;
+        float cy = (i + 0.5f) * stride;
+
+        // 容量 >= grid 总数，不会越界
+        int k = out.count++;
+        out.x1[k] = cx - dist[0] * stride;
+        out.y1[k] = cy - dist[1] * stride;
+        out.x2[k] = cx + dist[2] * stride;
+        out.y2[k] = cy + dist[3] * stride;
+        out.score[k] = score;
+        out.cls[k] = best;
+    }
+}
+
+// 整个模型的解码计划，rknn_query 之后编译一次
+struct YoloDecodePlan
+{
+    std::vector<YoloBranchPlan> branch;
+    int num_classes = 0;
+
+    /*
+     * out_attr: RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR 查询到的全部输出
+     * 相邻且 grid 相同的输出归为一个头，顺序为 box(4 * dfl_len), cls(num_classes),
+     * 可选的 score_sum(1)；stride 由模型输入宽度 / grid 宽度得到。
+     */
+    int compile(const rknn_tensor_attr *out_attr, int n_output,
+                int input_w, int input_h, float conf_thresh)
+    {
+        branch.clear();
+        num_classes = 0;
+
+        int i = 0;
+        while (i < n_output)
+        {
+            YoloBranchPlan br;
+            if (i + 1 >= n_output ||
+                br.box_l.init(out_attr[i]) < 0 || br.cls_l.init(out_attr[i + 1]) < 0)
+            {
+                printf("decode plan: output %d is not a NHWC box/cls pair\n", i);
+                return -1;
+            }
+            if (br.box_l.h != br.cls_l.h || br.box_l.w != br.cls_l.w || br.box_l.c % 4 != 0)
+            {
+                printf("decode plan: output %d/%d shape mismatch\n", i, i + 1);
+                return -1;
+            }
+            br.box_out = i;
+            br.cls_out = i + 1;
+            br.sum_out = -1;
+            i += 2;
+            if (i < n_output && br.sum_l.init(out_attr[i]) == 0 && br.sum_l.c == 1 &&
+                br.sum_l.h == br.box_l.h && br.sum_l.w == br.box_l.w)
+                br.sum_out = i++;
+
+            br.gh = br.box_l.h;
+            br.gw = br.box_l.w;
+            br.stride = input_w / br.gw;
+            br.num_classes = br.cls_l.c;
+            br.dfl_len = br.box_l.c / 4;
+            if (br.stride * br.gw != input_w || br.stride * br.gh != input_h)
+            {
+                printf("decode plan: grid %dx%d does not divide input %dx%d\n",
+                       br.gw, br.gh, input_w, input_h);
+                return -1;
+            }
+            if (num_classes && num_classes != br.num_classes)
+            {
+                printf("decode plan: class count differs between heads\n");
+                return -1;
+            }
+            num_classes = br.num_classes;
+
+            const rknn_tensor_attr &cls_attr = out_attr[br.cls_out];
+            br.sum_th = 0;
+            if (br.sum_out >= 0)
+            {
+                const rknn_tensor_attr &sum_attr = out_attr[br.sum_out];
+                br.sum_th = (int8_t)(conf_thresh / sum_attr.scale + sum_attr.zp);
+            }
+            // 既要过 conf_thresh，也要严格大于原标量扫描的初值 (int8_t)-zp。
+            // 原扫描没有类别超过初值时 cls 为 -1，而初值的分数 ((int8_t)-zp - zp) * scale
+            // 在 zp != -128 时可能过门限，会输出 cls = -1 的框；这里把这类 cell 直接丢掉，
+            // 所以只有 cls >= 0 的结果与原扫描逐位一致
+            br.cls_min_q = std::max(quant_min_q(cls_attr, conf_thresh),
+                                    (int)(int8_t)(-cls_attr.zp) + 1);
+            br.cls_zp = cls_attr.zp;
+            br.cls_scale = cls_attr.scale;
+            br.dfl.init(out_attr[br.box_out]);
+
+            // 常见形状走全展开的特化核，其余走通用核
+            if (br.num_classes == 80 && br.dfl_len == 16)
+                br.kernel = process_branch<80, 16>;
+            else if (br.dfl_len == 16)
+                br.kernel = process_branch<0, 16>;
+            else
+                br.kernel = process_branch<0, 0>;
+
+            branch.push_back(br);
+        }
+        return branch.empty() ? -1 : 0;
+    }
+
+    // 一帧最多的候选数: 每个 grid cell 至多一个
+    int capacity() const
+    {
+        int n = 0;
+        for (size_t b = 0; b < branch.size(); b++)
+            n += branch[b].gh * branch[b].gw;
+        return n;
+    }
+};
+
+// outputs: 全部输出张量的 virt_addr，下标同 out_attr
+static inline void yolo_decode(const YoloDecodePlan &plan,
+                               void *const *outputs,
+                               YoloCandidates &out)
+{
+    for (size_t b = 0; b < plan.branch.size(); b++)
+        plan.branch[b].kernel(plan.branch[b], outputs, out);
+}
+
+/* =================== NMS =================== */
+// 在候选存储上原地 NMS，结果写进 cand.keep[0..nkeep)
+static inline void yolo_nms(NmsEngine &engine, YoloCandidates &cand)
+{
+    cand.nkeep = engine.run(cand.x1.data(), cand.y1.data(),
+                            cand.x2.data(), cand.y2.data(),
+                            cand.score.data(), cand.cls.data(),
+                            cand.count, cand.keep.data());
+}
+
+#endif
@@ -0,0 +1,222 @@
+/*******************************************************
+ * yuv_ingest_bench.cpp
+ * 主机上对比两种 JPEG 入口: RGBA 解码 vs 平面 YUV 解码，
+ * 各自 letterbox 到 640x640 RGB 张量（SoftImageOps 代替 RGA）；
+ * 再加一路摄像头格式（NV12 / YUYV 的 dma-buf，经 import_dma_frame），没有解码
+ *******************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+#include "jpeg_decoder.h"
+#include "preprocess.h"
+#include "dma_pool.h"
+#include "frame_ingest.h"
+
+struct IngestResult
+{
+    double decode_ms, letterbox_ms;
+    size_t decode_bytes; // 解码写出
+    size_t resize_bytes; // 缩放读入（按被采样的有效区域估算）
+};
+
+static int run_ingest(JpegDecoder &jpeg, const std::vector<unsigned char> &jpg,
+                      const JpegInfo &info, int ingest, int iters,
+                      std::vector<uint8_t> &tensor, IngestResult *r)
+{
+    const int dst_w = 640, dst_h = 640;
+    LetterboxInfo full_lb = letterbox_info(info.width, info.height, dst_w, dst_h);
+    int dec_w, dec_h;
+    jpeg_pick_scale(info.width, info.height, full_lb.resize_w, full_lb.resize_h, &dec_w, &dec_h);
+    JpegLayout l = jpeg_layout(info, dec_w, dec_h, ingest);
+
+    std::vector<uint8_t> buf(l.size);
+    SoftImageOps soft_ops;
+    ImageBuffer src = make_image_buffer(-1, buf.data(), l.width, l.height,
+                                        l.format, l.wstride, l.hstride);
+    ImageBuffer dst = make_image_buffer(-1, tensor.data(), dst_w, dst_h, PIXEL_RGB888);
+
+    double dec = 0, lb = 0;
+    for (int i = 0; i < iters; i++)
+    {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        if (jpeg.decode(jpg.data(), jpg.size(), l, buf.data()) != 0)
+            return -1;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        if (letterbox_into(soft_ops, src, dst, NULL) != 0)
+            return -1;
+        auto t2 = std::chrono::high_resolution_clock::now();
+        dec += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        lb += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+
+    r->decode_ms = dec / iters;
+    r->letterbox_ms = lb / iters;
+    r->decode_bytes = l.size;
+    r->resize_bytes = pixel_buffer_size(l.format, l.width, l.height);
+    return 0;
+}
+
+/*
+ * 摄像头一路: 用 JPEG 解出的平面 YUV 拼一帧 ISP 式的输出
+ * （4:2:0 -> NV12，4:2:2 -> YUYV）放进 dma-buf，按外部帧导入后只计 letterbox。
+ * 其他采样方式返回 1（跳过）。
+ */
+static int run_camera(JpegDecoder &jpeg, const std::vector<unsigned char> &jpg,
+                      const JpegInfo &info, int iters, std::vector<uint8_t> &tensor,
+                      IngestResult *r, int *format)
+{
+    const int dst_w = 640, dst_h = 640;
+    LetterboxInfo full_lb = letterbox_info(info.width, info.height, dst_w, dst_h);
+    int dec_w, dec_h;
+    jpeg_pick_scale(info.width, info.height, full_lb.resize_w, full_lb.resize_h, &dec_w, &dec_h);
+    JpegLayout l = jpeg_layout(info, dec_w, dec_h, JPEG_INGEST_YUV);
+    if (!pixel_is_yuv(l.format))
+        return 1;
+
+    std::vector<uint8_t> planar(l.size);
+    if (jpeg.decode(jpg.data(), jpg.size(), l, planar.data()) != 0)
+        return -1;
+
+    *format = l.format == PIXEL_YUV420P ? PIXEL_NV12 : PIXEL_YUYV;
+    const int stride = l.wstride * pixel_bpp(*format);
+    DmaBuffer cam = dma_pool_cached().acquire(pixel_buffer_size(*format, l.wstride, l.hstride));
+    if (!cam)
+        return -1;
+    {
+        DmaCpuAccess cpu(cam, DMA_BUF_SYNC_WRITE);
+        const size_t luma = (size_t)l.wstride * l.hstride;
+        const int cw = l.wstride / 2;
+        const uint8_t *u = planar.data() + luma;
+        const uint8_t *v = u + (size_t)cw * (l.format == PIXEL_YUV420P ? l.hstride / 2 : l.hstride);
+        uint8_t *d = (uint8_t *)cam.virt();
+        if (*format == PIXEL_NV12)
+        {
+            memcpy(d, planar.data(), luma);
+            for (size_t i = 0; i < (size_t)cw * (l.hstride / 2); i++)
+            {
+                d[luma + 2 * i] = u[i];
+                d[luma + 2 * i + 1] = v[i];
+            }
+        }
+        else
+        {
+            for (int y = 0; y < l.hstride; y++)
+            {
+                for (int x = 0; x < cw; x++)
+                {
+                    uint8_t *q = d + (size_t)y * stride + x * 4;
+                    q[0] = planar[(size_t)y * l.wstride + 2 * x];
+                    q[1] = u[(size_t)y * cw + x];
+                    q[2] = planar[(size_t)y * l.wstride + 2 * x + 1];
+                    q[3] = v[(size_t)y * cw + x];
+                }
+            }
+        }
+    }
+
+    // JPEG 拼出来的是全范围；真正的 ISP 输出一般给 YUV_RANGE_LIMITED
+    DmaFrameDesc desc = {cam.fd(), *format, l.width, l.height, stride, l.hstride, YUV_RANGE_FULL};
+    ImageBuffer src;
+    if (import_dma_frame(desc, &src) != 0)
+        return -1;
+    src.virt = cam.virt(); // 板子上 RGA 只用 fd；主机的 SoftImageOps 要 virt
+    SoftImageOps soft_ops;
+    ImageBuffer dst = make_image_buffer(-1, tensor.data(), dst_w, dst_h, PIXEL_RGB888);
+
+    double lb = 0;
+    for (int i = 0; i < iters; i++)
+    {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        DmaCpuAccess cpu(cam, DMA_BUF_SYNC_READ);
+        if (letterbox_into(soft_ops, src, dst, NULL) != 0)
+            return -1;
+        lb += std::chrono::duration<double, std::milli>(
+                  std::chrono::high_resolution_clock::now() - t0)
+                  .count();
+    }
+
+    r->decode_ms = 0;
+    r->letterbox_ms = lb / iters;
+    r->decode_bytes = 0;
+    r->resize_bytes = pixel_buffer_size(*format, l.width, l.height);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s image.jpg [iters]\n", argv[0]);
+        return -1;
+    }
+    int iters = argc > 2 ? atoi(argv[2]) : 50;
+    if (iters <= 0)
+        iters = 1;
+
+    FILE *fp = fopen(argv[1], "rb");
+    if (!fp)
+    {
+        printf("open %s failed\n", argv[1]);
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long n = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    std::vector<unsigned char> jpg(n > 0 ? n : 0);
+    size_t got = fread(jpg.data(), 1, jpg.size(), fp);
+    fclose(fp);
+    if (n <= 0 || got != (size_t)n)
+    {
+        printf("read %s failed\n", argv[1]);
+        return -1;
+    }
+
+    JpegDecoder jpeg;
+    JpegInfo info;
+    if (jpeg.read_header(jpg.data(), jpg.size(), &info) != 0)
+        return -1;
+
+    const size_t tensor_bytes = 640 * 640 * 3;
+    std::vector<uint8_t> rgba_tensor(tensor_bytes), yuv_tensor(tensor_bytes),
+        cam_tensor(tensor_bytes);
+    IngestResult rgba, yuv, cam;
+    int cam_format = -1;
+    if (run_ingest(jpeg, jpg, info, JPEG_INGEST_RGBA, iters, rgba_tensor, &rgba) != 0 ||
+        run_ingest(jpeg, jpg, info, JPEG_INGEST_YUV, iters, yuv_tensor, &yuv) != 0)
+        return -1;
+    int cam_ret = run_camera(jpeg, jpg, info, iters, cam_tensor, &cam, &cam_format);
+    if (cam_ret < 0)
+        return -1;
+
+    // 两条路径的色彩转换 / 色度上采样不同，只看平均误差，不要求逐字节一致
+    double diff = 0;
+    for (size_t i = 0; i < tensor_bytes; i++)
+        diff += abs((int)rgba_tensor[i] - (int)yuv_tensor[i]);
+
+    printf("%s: %dx%d subsamp=%d, %d iters\n", argv[1], info.width, info.height, info.subsamp, iters);
+    printf("%-5s %10s %12s %12s %12s %12s\n", "path", "decode_ms", "letterbox_ms",
+           "decode_B", "resize_B", "total_B");
+    const IngestResult *res[3] = {&rgba, &yuv, &cam};
+    const char *name[3] = {"rgba", "yuv", cam_format == PIXEL_NV12 ? "nv12" : "yuyv"};
+    for (int i = 0; i < (cam_ret == 0 ? 3 : 2); i++)
+    {
+        size_t total = res[i]->decode_bytes + res[i]->resize_bytes + tensor_bytes;
+        printf("%-5s %10.3f %12.3f %12zu %12zu %12zu\n", name[i], res[i]->decode_ms,
+               res[i]->letterbox_ms, res[i]->decode_bytes, res[i]->resize_bytes, total);
+    }
+    if (yuv.decode_bytes == rgba.decode_bytes)
+        printf("note: subsampling not 4:2:0/4:2:2, yuv path fell back to rgba\n");
+    printf("mean abs diff rgba vs yuv: %.3f\n", diff / tensor_bytes);
+    if (cam_ret == 0)
+    {
+        // 同样的采样点和色度，只是排布不同，应该逐字节一致
+        size_t mismatch = 0;
+        for (size_t i = 0; i < tensor_bytes; i++)
+            mismatch += yuv_tensor[i] != cam_tensor[i];
+        printf("%s vs yuv mismatched bytes: %zu\n", name[2], mismatch);
+    }
+    return 0;
+}